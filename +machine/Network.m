@@ -48,6 +48,73 @@ classdef Network
 			r = machine.build.invoke( this.handle,'rate' );
 		end
 
+		% version of the weights; incremented whenever they're modified by train or load
+		function v = version( this )
+			v = machine.build.invoke( this.handle,'version' );
+		end
+
+		% hit / miss / eviction counters of the feedForward result cache
+		% (enable the cache with the 'cacheSize' parameter, in bytes)
+		function s = cacheStats( this )
+			s = machine.build.invoke( this.handle,'cacheStats' );
+		end
+
+		% rolling means of loss, throughput, gradient norm and step time over the last training steps
+		% (enable telemetry with the 'telemetry' parameter, a file name)
+		function s = telemetry( this )
+			s = machine.build.invoke( this.handle,'telemetry' );
+		end
+
+		% start recording a timeline of the forward, backward and update phases of every layer,
+		% and of the thread pool's tasks
+		function traceStart( this )
+			machine.build.invoke( this.handle,'traceStart' );
+		end
+
+		% stop recording, and write the timeline to 'file' (open it in chrome://tracing or ui.perfetto.dev)
+		function traceWrite( this, file )
+			machine.build.invoke( this.handle,'traceWrite', file );
+		end
+
+		% bytes held for weights, gradients, optimizer state, activations and scratch, per layer and in total
+		function s = memory( this )
+			s = machine.build.invoke( this.handle,'memory' );
+		end
+
+		% where the threads and weights were placed (with the 'numa' parameter set)
+		function s = placement( this )
+			s = machine.build.invoke( this.handle,'placement' );
+		end
+
+		% most probable class (1-based) of each column of 'inputs'
+		% (predict and topK need a network built with the 'softmaxOutput' parameter set)
+		function labels = predict( this, inputs )
+			labels = machine.build.invoke( this.handle,'predict', inputs );
+		end
+
+		% the k most probable classes (1-based) of each column of 'inputs', and their probabilities
+		function [labels, probs] = topK( this, inputs, k )
+			[labels, probs] = machine.build.invoke( this.handle,'topK', inputs, k );
+		end
+
+		% score the network on the columns of 'inputs' against the columns of 'targets': mse, cross-entropy,
+		% accuracy and a confusion matrix (rows are the target class, columns the predicted class)
+		function m = evaluate( this, inputs, targets )
+			m = machine.build.invoke( this.handle,'evaluate', inputs, targets );
+		end
+
+		% zero the smallest weights of every layer until 'sparsity' (0 to 1) of them are zero;
+		% layers that get faster are switched to a sparse kernel. Returns a report per layer.
+		function report = prune( this, sparsity )
+			report = machine.build.invoke( this.handle,'prune', sparsity );
+		end
+
+		% write the network to 'file' as a self-contained C++ header, with its weights and
+		% forward function in namespace 'name'
+		function exportHeader( this, file, name )
+			machine.build.invoke( this.handle,'exportHeader', file, name );
+		end
+
 		% function weights( this )
 		% 	getLayer
 		% end
@@ -80,4 +147,18 @@ classdef Network
 		end
 
 	end % end methods
+
+	methods (Static)
+
+		% bytes a network built from 'params' would take, training on batches of 'batch' samples
+		% (by default, params.batchSize), worked out without building it
+		function s = estimate( params, batch )
+			if ( exist('batch','var') )
+				s = machine.build.invoke( params,'estimate', batch );
+			else
+				s = machine.build.invoke( params,'estimate' );
+			end
+		end
+
+	end % end static methods
 end
\ No newline at end of file
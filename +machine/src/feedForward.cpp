@@ -16,11 +16,12 @@
 #include "network.h"
 #include "mex.h"
 #include "mexutils.h"
+#include "mexmodel.h"
 
 /**
  * in Matlab, this function takes the parameters:
  * 		:param handle - a pointer to a C++ Network class
- *		:param inputV - input vector
+ *		:param inputV - input vector (a sparse vector is fed through the sparse-input path)
  * and returns
  *		:return - the ouput vector of the network
  *
@@ -35,15 +36,44 @@ void mexFunction ( int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
 	if ( nrhs > 1 ) 
 	{
-		// cast the mxArray* back to a Network*
-		auto handle = mex::Handle<machine::Network>(prhs[0]);
-		machine::Network* net = handle;
+		// cast the mxArray* back to a MexModel*, and read from its latest snapshot
+		auto handle = mex::Handle<MexModel>(prhs[0]);
+		MexModel* model = handle;
+		machine::ModelHolder::Reader net( model->serving() );
 
-		// cast the second argument into a vector
-		std::vector<double> inputV = mex::mex2vector<double>(prhs[1]);
+		std::vector<double> output;
 
-		// feed the input vector forward into the network
-		std::vector<double> output = net->feedForward(inputV);
+		if ( mxIsSparse(prhs[1]) )
+		{
+			// only the nonzeros of a sparse vector are passed on, as (index, value) pairs
+			const double* values = mxGetPr(prhs[1]);
+			const mwIndex* rows = mxGetIr(prhs[1]);
+			const mwIndex* cols = mxGetJc(prhs[1]);
+			bool isRow = mxGetM(prhs[1]) == 1;
+
+			machine::sparse_vector inputV;
+			if ( isRow )
+			{
+				for (size_t j = 0; j < mxGetN(prhs[1]); ++j)
+					for (mwIndex k = cols[j]; k < cols[j+1]; ++k)
+						inputV.push_back( std::make_pair( (int)j, values[k] ) );
+			}
+			else
+			{
+				for (mwIndex k = cols[0]; k < cols[1]; ++k)
+					inputV.push_back( std::make_pair( (int)rows[k], values[k] ) );
+			}
+
+			output = net->feedForwardSparse(inputV);
+		}
+		else
+		{
+			// cast the second argument into a vector
+			std::vector<double> inputV = mex::mex2vector<double>(prhs[1]);
+
+			// feed the input vector forward into the network
+			output = net->feedForward(inputV);
+		}
 
 		// return the output vector
 		plhs[0] = mex::vector2mex<double>(output);
@@ -14,8 +14,46 @@
 
 #include <string>
 #include "network.h"
+#include "cache.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "classifier.h"
 #include "mex.h"
 #include "mexutils.h"
+#include "mexparams.h"
+#include "mexmodel.h"
+
+// a struct of the byte counts in 'usage', with a struct array of the layers' counts as 'layers'
+static mxArray* memoryStruct ( const machine::Network::MemoryUsage& usage )
+{
+	const char* layerFields[] = { "layer", "weights", "gradient", "optimizer", "copies", "activations", "total" };
+	mxArray* layers = mxCreateStructMatrix(1, usage.layers.size(), 7, layerFields);
+
+	for (size_t i = 0; i < usage.layers.size(); ++i)
+	{
+		const machine::Network::LayerMemory& m = usage.layers[i];
+		mxSetField(layers, i, "layer", mxCreateDoubleScalar(m.layer));
+		mxSetField(layers, i, "weights", mxCreateDoubleScalar(m.weights));
+		mxSetField(layers, i, "gradient", mxCreateDoubleScalar(m.gradient));
+		mxSetField(layers, i, "optimizer", mxCreateDoubleScalar(m.optimizer));
+		mxSetField(layers, i, "copies", mxCreateDoubleScalar(m.copies));
+		mxSetField(layers, i, "activations", mxCreateDoubleScalar(m.activations));
+		mxSetField(layers, i, "total", mxCreateDoubleScalar(m.total));
+	}
+
+	const char* fields[] = { "weights", "gradient", "optimizer", "copies", "activations", "scratch", "cache", "total", "layers" };
+	mxArray* s = mxCreateStructMatrix(1, 1, 9, fields);
+	mxSetField(s, 0, "weights", mxCreateDoubleScalar(usage.weights));
+	mxSetField(s, 0, "gradient", mxCreateDoubleScalar(usage.gradient));
+	mxSetField(s, 0, "optimizer", mxCreateDoubleScalar(usage.optimizer));
+	mxSetField(s, 0, "copies", mxCreateDoubleScalar(usage.copies));
+	mxSetField(s, 0, "activations", mxCreateDoubleScalar(usage.activations));
+	mxSetField(s, 0, "scratch", mxCreateDoubleScalar(usage.scratch));
+	mxSetField(s, 0, "cache", mxCreateDoubleScalar(usage.cache));
+	mxSetField(s, 0, "total", mxCreateDoubleScalar(usage.total));
+	mxSetField(s, 0, "layers", layers);
+	return s;
+}
 
 /**
  * in Matlab, this function takes the parameters:
@@ -39,10 +77,33 @@ void mexFunction ( int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	if ( nrhs < 2 )
 		mexErrMsgTxt("Second argument should not be empty. Expected a method to invoke.");
 
+	// 'estimate' sizes a network before it's built, so it takes a struct of parameters (and optionally
+	// a batch size) in place of a handle
+	if ( mxIsStruct( prhs[0] ) )
+	{
+		char* method = mxArrayToString(prhs[1]);
+		const bool estimate = !strcmp("estimate", method);
+		mxFree(method);
+
+		if ( !estimate )
+			mexErrMsgTxt("Expected a handle to a Network.");
+
+		MexParameters params( prhs[0] );
+		const int batch = nrhs > 2 ? (int)mxGetScalar(prhs[2]) : 0;
+
+		try {
+			plhs[0] = memoryStruct( machine::Network::estimate( params, batch ) );
+		} catch ( std::exception& e ) {
+			mexErrMsgTxt(e.what());
+		}
+		return;
+	}
+
 	// the first parameter should be a handle to the Network instance
-	// so, cast the mxArray* back to a Network*
-	auto handle = mex::Handle<machine::Network>(prhs[0]);
-	machine::Network* net = handle;
+	// so, cast the mxArray* back to a MexModel*
+	auto handle = mex::Handle<MexModel>(prhs[0]);
+	MexModel* model = handle;
+	machine::Network* net = &model->network();
 
 	// the second parameter should be the name of a method to invoke
 	char* method = mxArrayToString(prhs[1]);
@@ -57,6 +118,209 @@ void mexFunction ( int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	    return;
 	}
 
+	if(!strcmp("version", method)) {
+    	plhs[0] = mxCreateDoubleScalar(net->version());
+	    return;
+	}
+
+	// most probable class of each column of the input matrix (1-based, as a row vector)
+	if(!strcmp("predict", method)) {
+		if ( nrhs < 3 )
+			mexErrMsgTxt("predict expects an input matrix.");
+
+		std::vector<double> labels;
+		try {
+			machine::Classifier<double> classifier(*net);
+			labels = classifier.predict( mex::mex2batch<double>(prhs[2]) );
+		} catch ( std::exception& e ) {
+			mexErrMsgTxt(e.what());
+		}
+
+		plhs[0] = mxCreateDoubleMatrix(1, labels.size(), mxREAL);
+		double* out = mxGetPr(plhs[0]);
+		for (size_t i = 0; i < labels.size(); ++i)
+			out[i] = labels[i] + 1;
+	    return;
+	}
+
+	// the k most probable classes of each column of the input matrix (1-based, k x n)
+	// and optionally their probabilities
+	if(!strcmp("topK", method)) {
+		if ( nrhs < 4 )
+			mexErrMsgTxt("topK expects an input matrix and k.");
+
+		size_t k = (size_t)mxGetScalar(prhs[3]);
+		std::vector<std::vector<machine::Classifier<double>::scored_label> > result;
+		try {
+			machine::Classifier<double> classifier(*net);
+			result = classifier.topK( mex::mex2batch<double>(prhs[2]), k );
+		} catch ( std::exception& e ) {
+			mexErrMsgTxt(e.what());
+		}
+
+		plhs[0] = mxCreateDoubleMatrix(k, result.size(), mxREAL);
+		double* labels = mxGetPr(plhs[0]);
+		double* probs = nullptr;
+		if ( nlhs > 1 ) {
+			plhs[1] = mxCreateDoubleMatrix(k, result.size(), mxREAL);
+			probs = mxGetPr(plhs[1]);
+		}
+
+		for (size_t j = 0; j < result.size(); ++j)
+			for (size_t i = 0; i < result[j].size(); ++i) {
+				labels[ j * k + i ] = result[j][i].first + 1;
+				if ( probs )
+					probs[ j * k + i ] = result[j][i].second;
+			}
+	    return;
+	}
+
+	// mse, cross-entropy, accuracy and confusion matrix over the columns of an input and a target matrix
+	if(!strcmp("evaluate", method)) {
+		if ( nrhs < 4 )
+			mexErrMsgTxt("evaluate expects an input matrix and a target matrix.");
+
+		machine::Network::Metrics metrics;
+		try {
+			metrics = net->evaluate( mex::mex2batch<double>(prhs[2]), mex::mex2batch<double>(prhs[3]) );
+		} catch ( std::exception& e ) {
+			mexErrMsgTxt(e.what());
+		}
+
+		const size_t classes = metrics.confusion.size();
+		mxArray* confusion = mxCreateDoubleMatrix(classes, classes, mxREAL);
+		double* counts = mxGetPr(confusion);
+		for (size_t t = 0; t < classes; ++t)
+			for (size_t p = 0; p < classes; ++p)
+				counts[ p * classes + t ] = metrics.confusion[t][p];
+
+		const char* fields[] = { "samples", "mse", "crossEntropy", "accuracy", "confusion", "seconds" };
+		plhs[0] = mxCreateStructMatrix(1, 1, 6, fields);
+		mxSetField(plhs[0], 0, "samples", mxCreateDoubleScalar(metrics.samples));
+		mxSetField(plhs[0], 0, "mse", mxCreateDoubleScalar(metrics.mse));
+		mxSetField(plhs[0], 0, "crossEntropy", mxCreateDoubleScalar(metrics.crossEntropy));
+		mxSetField(plhs[0], 0, "accuracy", mxCreateDoubleScalar(metrics.accuracy));
+		mxSetField(plhs[0], 0, "confusion", confusion);
+		mxSetField(plhs[0], 0, "seconds", mxCreateDoubleScalar(metrics.seconds));
+	    return;
+	}
+
+	// prune every layer to the given sparsity, returning a struct array with a report per layer
+	if(!strcmp("prune", method)) {
+		if ( nrhs < 3 )
+			mexErrMsgTxt("prune expects a target sparsity between 0 and 1.");
+
+		auto reports = net->pruneToSparsity( mxGetScalar(prhs[2]) );
+		model->changed();
+		const char* fields[] = { "layer", "nonzeros", "sparsity", "speedup", "converted" };
+		plhs[0] = mxCreateStructMatrix(reports.size(), 1, 5, fields);
+
+		for (size_t i = 0; i < reports.size(); ++i) {
+			mxSetField(plhs[0], i, "layer", mxCreateDoubleScalar(reports[i].layer + 1));
+			mxSetField(plhs[0], i, "nonzeros", mxCreateDoubleScalar(reports[i].nonzeros));
+			mxSetField(plhs[0], i, "sparsity", mxCreateDoubleScalar(reports[i].sparsity));
+			mxSetField(plhs[0], i, "speedup", mxCreateDoubleScalar(reports[i].speedup));
+			mxSetField(plhs[0], i, "converted", mxCreateLogicalScalar(reports[i].converted));
+		}
+	    return;
+	}
+
+	// write the network out as a standalone C++ header
+	if(!strcmp("exportHeader", method)) {
+		if ( nrhs < 4 )
+			mexErrMsgTxt("exportHeader expects a file name and a namespace.");
+
+		char* file = mxArrayToString(prhs[2]);
+		char* name = mxArrayToString(prhs[3]);
+		try {
+			net->exportHeader( file, name );
+		} catch ( std::exception& e ) {
+			mxFree(file);
+			mxFree(name);
+			mexErrMsgTxt(e.what());
+		}
+		mxFree(file);
+		mxFree(name);
+	    return;
+	}
+
+	// bytes held by the network, per layer and in total
+	if(!strcmp("memory", method)) {
+		plhs[0] = memoryStruct( net->memory() );
+	    return;
+	}
+
+	// start recording trace spans (the tracer is shared by every network in the process)
+	if(!strcmp("traceStart", method)) {
+		machine::Tracer::global().start();
+	    return;
+	}
+
+	// stop recording, and write the spans out as a Chrome trace
+	if(!strcmp("traceWrite", method)) {
+		if ( nrhs < 3 )
+			mexErrMsgTxt("traceWrite expects a file name.");
+
+		char* file = mxArrayToString(prhs[2]);
+		try {
+			machine::Tracer::global().write( file );
+		} catch ( std::exception& e ) {
+			mxFree(file);
+			mexErrMsgTxt(e.what());
+		}
+		mxFree(file);
+	    return;
+	}
+
+	// description of where the threads and weights were placed on a NUMA machine
+	if(!strcmp("placement", method)) {
+		plhs[0] = mxCreateString( net->placement().describe().c_str() );
+	    return;
+	}
+
+	// statistics of the feedForward result cache, or an empty matrix if it's disabled
+	// (feedForward reads from the latest snapshot, so that's the cache it fills)
+	if(!strcmp("cacheStats", method)) {
+		machine::ModelHolder::Reader serving( model->serving() );
+		if ( !serving->cache() ) {
+			plhs[0] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			return;
+		}
+
+		machine::InferenceCache::Stats st = serving->cache()->stats();
+		const char* fields[] = { "hits", "misses", "insertions", "evictions", "entries", "bytes", "capacity" };
+		plhs[0] = mxCreateStructMatrix(1, 1, 7, fields);
+		mxSetField(plhs[0], 0, "hits", mxCreateDoubleScalar(st.hits));
+		mxSetField(plhs[0], 0, "misses", mxCreateDoubleScalar(st.misses));
+		mxSetField(plhs[0], 0, "insertions", mxCreateDoubleScalar(st.insertions));
+		mxSetField(plhs[0], 0, "evictions", mxCreateDoubleScalar(st.evictions));
+		mxSetField(plhs[0], 0, "entries", mxCreateDoubleScalar(st.entries));
+		mxSetField(plhs[0], 0, "bytes", mxCreateDoubleScalar(st.bytes));
+		mxSetField(plhs[0], 0, "capacity", mxCreateDoubleScalar(st.capacity));
+	    return;
+	}
+
+	// rolling means over the most recent training steps, or an empty matrix if telemetry is disabled
+	if(!strcmp("telemetry", method)) {
+		if ( !net->telemetry() ) {
+			plhs[0] = mxCreateDoubleMatrix(0, 0, mxREAL);
+			return;
+		}
+
+		machine::Telemetry::Aggregates a = net->telemetry()->aggregates();
+		const char* fields[] = { "steps", "dropped", "window", "loss", "samplesPerSecond", "rate", "gradientNorm", "seconds" };
+		plhs[0] = mxCreateStructMatrix(1, 1, 8, fields);
+		mxSetField(plhs[0], 0, "steps", mxCreateDoubleScalar(a.steps));
+		mxSetField(plhs[0], 0, "dropped", mxCreateDoubleScalar(a.dropped));
+		mxSetField(plhs[0], 0, "window", mxCreateDoubleScalar(a.window));
+		mxSetField(plhs[0], 0, "loss", mxCreateDoubleScalar(a.loss));
+		mxSetField(plhs[0], 0, "samplesPerSecond", mxCreateDoubleScalar(a.samplesPerSecond));
+		mxSetField(plhs[0], 0, "rate", mxCreateDoubleScalar(a.rate));
+		mxSetField(plhs[0], 0, "gradientNorm", mxCreateDoubleScalar(a.gradientNorm));
+		mxSetField(plhs[0], 0, "seconds", mxCreateDoubleScalar(a.seconds));
+	    return;
+	}
+
 	// if(!strcmp("size", method)) {
  //    	plhs[0] = mxCreateDoubleScalar(net->size());
 	//     return;
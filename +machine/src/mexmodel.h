@@ -0,0 +1,67 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _            
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___ 
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *                                                          
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */  
+
+
+#ifndef MEXMODEL_H
+#define MEXMODEL_H
+
+#include <memory>
+#include "network.h"
+#include "holder.h"
+#include "mexparams.h"
+
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 			 						Mex Model
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * what a Matlab handle points to: the network that's trained, and a ModelHolder that
+ * feedForward reads a snapshot of it from
+ *
+ * training marks the snapshot as stale, and the next read publishes a fresh one, so a
+ * feedForward never waits on (or sees half of) a training step
+ *
+ */
+class MexModel
+{
+public:
+
+	// takes ownership of 'params'
+	explicit MexModel ( MexParameters* params )
+		: params(params), net(new machine::Network(params)), holder(this->net->snapshot()), stale(false) {}
+
+	// the network to train, prune or inspect; call 'changed' after modifying it
+	machine::Network& network () { return *this->net; }
+
+	void changed () { this->stale = true; }
+
+	// the holder to read from, brought up to date with the network first
+	machine::ModelHolder& serving ()
+	{
+		if ( this->stale ) {
+			this->holder.publish( this->net->snapshot() );
+			this->stale = false;
+		}
+		return this->holder;
+	}
+
+private:
+
+	// declared in construction order: the networks hold on to the parameters
+	std::unique_ptr<MexParameters> params;
+	std::unique_ptr<machine::Network> net;
+	machine::ModelHolder holder;
+	bool stale;
+};
+
+#endif
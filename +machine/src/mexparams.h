@@ -0,0 +1,253 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _            
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___ 
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *                                                          
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */  
+
+#ifndef MEXPARAMS_H
+#define MEXPARAMS_H
+
+#include <string>
+#include "network.h"
+#include "mex.h"
+#include "mexutils.h"
+
+/**
+ * Convert a string to an integer
+ * --- 
+ * this is useful because a switch is a little faster than a bunch 
+ * of repeated ifs, especially if some of it can be evaluated at compile time.
+ * But C++ switches can only take integers as inputs, so we must convert the string to an int
+ *
+ * from http://stackoverflow.com/questions/16388510/evaluate-a-string-with-a-switch-in-c
+ */
+static constexpr unsigned int str2int(const char* str, int h = 0)
+{
+	return !str[h] ? 5381 : (str2int(str, h+1)*33) ^ str[h];
+}
+
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 			 						Mex Parameters
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Construct a Network parameters object from a mex structure array
+ *
+ */
+class MexParameters : public machine::Network::Parameters
+{
+public:
+	MexParameters( const mxArray* params ) 
+	{
+		// initialize defaults
+		this->inputs(3);
+		this->outputs(5);
+		this->hiddenLayers(1);
+		this->hiddenSize(0);
+		this->biasTerm(true);
+		this->rate(0.001);
+		this->momentum(0.9);
+		this->decay(0.999);
+		this->epsilon(1e-8);
+		this->batchSize(1);
+		this->memoryBudget(0);
+		this->checkpointInterval(0);
+		this->mixedPrecision(false);
+		this->lossScale(1);
+		this->cacheSize(0);
+		this->numa(false);
+		this->softmaxOutput(false);
+		this->activation(machine::sigmoid);
+		this->initialization(machine::uniform);
+		this->propogation(machine::dotprod);
+		this->training(machine::backPropogation);
+
+		if ( mxIsStruct( params ) )
+		{
+			int nfields = mxGetNumberOfFields( params );
+
+			for (int i = 0; i < nfields; ++i)
+			{
+				// retrieve the fieldname and value
+				const char *fieldname = mxGetFieldNameByNumber(params, i);
+				auto value = mxGetFieldByNumber(params, 0, i);
+
+				// Marshal mex pointers to native C++ types
+				auto m = mex::Marshal(value);
+
+				// TODO, find a better way to do this than an incredibly ugly switch statement
+				switch (str2int(fieldname))
+				{
+					case str2int("inputs") :
+						this->inputs((unsigned int)m);
+						break;
+					case str2int("outputs") :
+						this->outputs((unsigned int)m);
+						break;
+					case str2int("hiddenLayers") :
+						this->hiddenLayers((unsigned int)m);
+						break;
+					case str2int("hiddenSize") :
+						this->hiddenSize((unsigned int)m);
+						break;
+					case str2int("layerSizes") :
+					{
+						std::vector<double> sizes = mex::mex2vector<double>(value);
+						this->layerSizes( std::vector<unsigned int>( sizes.begin(), sizes.end() ) );
+						break;
+					}
+					case str2int("biasTerm") :
+						this->hiddenSize((bool)m);
+						break;
+					case str2int("rate") :
+						this->rate((double)m);
+						break;
+					case str2int("momentum") :
+						this->momentum((double)m);
+						break;
+					case str2int("decay") :
+						this->decay((double)m);
+						break;
+					case str2int("epsilon") :
+						this->epsilon((double)m);
+						break;
+					case str2int("batchSize") :
+						this->batchSize((int)(double)m);
+						break;
+					case str2int("memoryBudget") :
+						this->memoryBudget((size_t)(double)m);
+						break;
+					case str2int("checkpointInterval") :
+						this->checkpointInterval((int)(double)m);
+						break;
+					case str2int("mixedPrecision") :
+						this->mixedPrecision((double)m != 0);
+						break;
+					case str2int("lossScale") :
+						this->lossScale((double)m);
+						break;
+					case str2int("cacheSize") :
+						this->cacheSize((size_t)(double)m);
+						break;
+					case str2int("telemetry") :
+						if( mxIsChar(value) )
+							this->telemetry( std::string( (char*)m ) );
+						break;
+					case str2int("numa") :
+						this->numa((double)m != 0);
+						break;
+					case str2int("softmaxOutput") :
+						this->softmaxOutput((double)m != 0);
+						break;
+					case str2int("seed") :
+						this->seed((uint64_t)(double)m);
+						break;
+					case str2int("activation") :
+					case str2int("act") :
+					{
+						if( mxIsChar(value) )
+						{
+							// find the correct activation function
+							switch ( str2int((char*)m) )
+							{
+								case str2int("sigmoid") :
+									this->activation(machine::sigmoid);
+									break;
+								case str2int("softplus") :
+									this->activation(machine::softplus);
+									break;
+								case str2int("tanh") :
+								case str2int("hyperbolic_tan") :
+									this->activation(machine::hyperbolic_tan);
+									break;
+							}
+
+						}
+						break;
+					}
+					case str2int("initialization") :
+					case str2int("init") :
+					{
+						if( mxIsChar(value) )
+						{
+							// find the correct initialization function
+							switch ( str2int((char*)m) )
+							{
+								case str2int("random") :
+									this->initialization(machine::random);
+									break;
+								case str2int("uniform") :
+									this->initialization(machine::uniform);
+									break;
+								case str2int("xavier") :
+								case str2int("glorot") :
+									this->initialization(machine::xavier);
+									break;
+								case str2int("he") :
+									this->initialization(machine::he);
+									break;
+							}
+						}
+						break;
+					}
+					case str2int("propogation") :
+					case str2int("prop") :
+					{
+						if( mxIsChar(value) )
+						{	
+							// find the correct propogation function
+							switch ( str2int((char*)m) )
+							{
+								case str2int("dotprod") :
+								case str2int("dot") :
+									this->propogation(machine::dotprod);
+									break;
+							}
+						}
+						break;
+					}
+					case str2int("training") :
+					case str2int("train") :
+					{
+						if( mxIsChar(value) )
+						{	
+							// find the correct propogation function
+							switch ( str2int((char*)m) )
+							{
+								case str2int("backPropogation") :
+								case str2int("sgd") :
+									this->training(machine::backPropogation);
+									break;
+								case str2int("momentum") :
+									this->training(machine::momentum);
+									break;
+								case str2int("nesterov") :
+									this->training(machine::nesterov);
+									break;
+								case str2int("rmsprop") :
+									this->training(machine::rmsprop);
+									break;
+								case str2int("adam") :
+									this->training(machine::adam);
+									break;
+							}
+						}
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	~MexParameters(){}
+};
+
+#endif
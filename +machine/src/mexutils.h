@@ -68,6 +68,25 @@ namespace mex {
 		return vec;
 	}
 
+	/**
+	 *
+	 * marshall the columns of an mxArray* matrix into a vector of vectors (one per column)
+	 *
+	 */
+	template<class T> std::vector<std::vector<T> > mex2batch( const mxArray* mx )
+	{
+		T* array = (T*)mxGetData(mx);
+		size_t rows = mxGetM(mx);
+		size_t cols = mxGetN(mx);
+
+		std::vector<std::vector<T> > batch(cols);
+
+		for (size_t j = 0; j < cols; ++j)
+			batch[j] = std::vector<T>( array + j * rows, array + (j + 1) * rows );
+
+		return batch;
+	}
+
 	/**
 	 *
 	 * marshall a vector of a template type into an mxArray*
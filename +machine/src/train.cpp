@@ -16,6 +16,7 @@
 #include "network.h"
 #include "mex.h"
 #include "mexutils.h"
+#include "mexmodel.h"
 
 /**
  * in Matlab, this function takes the parameters:
@@ -34,15 +35,16 @@ void mexFunction ( int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
 	if ( nrhs > 1 ) 
 	{
-		// cast the mxArray* back to a Network*
-		auto handle = mex::Handle<machine::Network>(prhs[0]);
-		machine::Network* net = handle;
+		// cast the mxArray* back to a MexModel*
+		auto handle = mex::Handle<MexModel>(prhs[0]);
+		MexModel* model = handle;
 
 		// cast the second and third arguments into vectors
 		std::vector<double> inputV = mex::mex2vector<double>(prhs[1]);
 		std::vector<double> expectedV = mex::mex2vector<double>(prhs[2]);
 
-		std::vector<double> output = net->train( inputV, expectedV );
+		std::vector<double> output = model->network().train( inputV, expectedV );
+		model->changed();
 
 		plhs[0] = mex::vector2mex<double>(output);
 	}
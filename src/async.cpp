@@ -0,0 +1,214 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "async.h"
+
+namespace machine {
+
+	InferenceQueue::InferenceQueue ( Network& net, size_t depth, int batch, ThreadPool& pool )
+		: net(net), pool(pool), capacity( std::max( depth, (size_t)1 ) ), batch( std::max( batch, 1 ) ), widest( net.inputs() ), admitted(0), runners(0)
+	{
+		for (auto it = net.begin(); it != net.end(); ++it)
+			this->widest = std::max( this->widest, (size_t)it->size() );
+	}
+
+	InferenceQueue::~InferenceQueue()
+	{
+		std::unique_lock<std::mutex> lock( this->mutex );
+		this->idle.wait( lock, [this]{ return this->admitted == 0 && this->runners == 0; } );
+	}
+
+	void InferenceQueue::check ( const std::vector<double>& input ) const
+	{
+		if ( (int)input.size() != this->net.inputs() )
+			throw std::invalid_argument("InferenceQueue: expected " + std::to_string( this->net.inputs() ) + " inputs");
+	}
+
+	std::future<std::vector<double> > InferenceQueue::submit ( std::vector<double> input )
+	{
+		this->check(input);
+
+		Request request;
+		request.input = std::move(input);
+		std::future<std::vector<double> > result = request.promise.get_future();
+
+		{
+			std::unique_lock<std::mutex> lock( this->mutex );
+			this->space.wait( lock, [this]{ return this->admitted < this->capacity; } );
+			++this->admitted;
+		}
+
+		this->push( std::move(request) );
+		return result;
+	}
+
+	void InferenceQueue::submit ( std::vector<double> input, callback done )
+	{
+		this->check(input);
+
+		{
+			std::unique_lock<std::mutex> lock( this->mutex );
+			this->space.wait( lock, [this]{ return this->admitted < this->capacity; } );
+			++this->admitted;
+		}
+
+		Request request;
+		request.input = std::move(input);
+		request.done = std::move(done);
+		this->push( std::move(request) );
+	}
+
+	bool InferenceQueue::trySubmit ( std::vector<double> input, callback done )
+	{
+		this->check(input);
+
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+			if ( this->admitted >= this->capacity )
+				return false;
+
+			++this->admitted;
+		}
+
+		Request request;
+		request.input = std::move(input);
+		request.done = std::move(done);
+		this->push( std::move(request) );
+		return true;
+	}
+
+	void InferenceQueue::wait ()
+	{
+		std::unique_lock<std::mutex> lock( this->mutex );
+		this->idle.wait( lock, [this]{ return this->admitted == 0; } );
+	}
+
+	size_t InferenceQueue::inFlight () const
+	{
+		std::lock_guard<std::mutex> lock( this->mutex );
+		return this->admitted;
+	}
+
+	size_t InferenceQueue::depth () const
+	{
+		return this->capacity;
+	}
+
+	// queue an admitted request, and start another runner if there's a worker free for it
+	void InferenceQueue::push ( Request request )
+	{
+		bool start = false;
+
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+			this->pending.push_back( std::move(request) );
+
+			if ( this->runners < std::max( this->pool.size(), 1u ) )
+			{
+				++this->runners;
+				start = true;
+			}
+		}
+
+		if ( !start )
+			return;
+
+		if ( this->pool.size() == 0 )
+			this->run();
+		else
+			this->pool.enqueue( [this]{ this->run(); } );
+	}
+
+	/**
+	 * a runner: take up to 'batch' of the waiting requests at a time, run them through the network
+	 * together, and complete them, until there are none left
+	 */
+	void InferenceQueue::run ()
+	{
+		std::vector<Request> work;
+		std::vector<double> a( this->batch * this->widest ), b( this->batch * this->widest );
+		const int width = this->net.inputs();
+		const int outputs = this->net.outputs();
+
+		for (;;)
+		{
+			{
+				std::lock_guard<std::mutex> lock( this->mutex );
+
+				if ( this->pending.empty() )
+				{
+					--this->runners;
+					if ( this->runners == 0 )
+						this->idle.notify_all();
+					return;
+				}
+
+				while ( !this->pending.empty() && (int)work.size() < this->batch )
+				{
+					work.push_back( std::move( this->pending.front() ) );
+					this->pending.pop_front();
+				}
+			}
+
+			const int m = work.size();
+			std::exception_ptr error;
+
+			try
+			{
+				for (int s = 0; s < m; ++s)
+					std::copy( work[s].input.begin(), work[s].input.end(), a.begin() + s * width );
+
+				for (auto it = this->net.begin(); it != this->net.end(); ++it)
+				{
+					it->forward( a.data(), b.data(), m );
+					a.swap(b);
+				}
+			}
+			catch ( ... )
+			{
+				error = std::current_exception();
+			}
+
+			for (int s = 0; s < m; ++s)
+			{
+				std::vector<double> output;
+				if ( !error )
+					output.assign( a.begin() + s * outputs, a.begin() + ( s + 1 ) * outputs );
+
+				if ( work[s].done )
+					work[s].done( std::move(output), error );
+				else if ( error )
+					work[s].promise.set_exception( error );
+				else
+					work[s].promise.set_value( std::move(output) );
+			}
+
+			work.clear();
+
+			{
+				std::lock_guard<std::mutex> lock( this->mutex );
+				this->admitted -= m;
+				if ( this->admitted == 0 )
+					this->idle.notify_all();
+			}
+
+			this->space.notify_all();
+		}
+	}
+}
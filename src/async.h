@@ -0,0 +1,117 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "network.h"
+#include "threadpool.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Inference Queue
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * asynchronous feedForward on the thread pool
+	 *
+	 * 'submit' queues an input and returns straight away, with a future of the output, or hands the
+	 * output to a callback when it's ready, so one thread can keep many requests in flight. The
+	 * requests waiting when a worker comes round for more are run together, up to 'batch' at a
+	 * time, through the layers' batched kernels.
+	 *
+	 * at most 'depth' requests are admitted at once (queued or running). Past that, 'submit' waits
+	 * for a slot, and 'trySubmit' refuses the request instead, for callers that mustn't block.
+	 *
+	 * callbacks run on a pool thread; they shouldn't block, and mustn't throw. The network mustn't
+	 * be trained while requests are in flight (see ModelHolder for swapping in a retrained one).
+	 * When the pool has no workers, requests are run on the submitting thread.
+	 *
+	 * a runner holds a pool worker for as long as there are requests waiting; the kernels' parallel
+	 * loops never pick one up while they wait on their own chunks (see ThreadPool::parallelFor).
+	 *
+	 */
+	class InferenceQueue
+	{
+	public:
+
+		// receives the output, or the exception that stopped it being computed
+		typedef std::function<void( std::vector<double>, std::exception_ptr )> callback;
+
+		/**
+		 * :param net - the network to run
+		 * :param depth - most requests admitted at once
+		 * :param batch - most requests run together
+		 * :param pool - where the requests are run
+		 */
+		InferenceQueue ( Network&, size_t = 256, int = 16, ThreadPool& = ThreadPool::global() );
+
+		// waits for every request in flight
+		~InferenceQueue();
+
+		// queue an input, waiting for a slot if the queue is full
+		std::future<std::vector<double> > submit ( std::vector<double> );
+		void submit ( std::vector<double>, callback );
+
+		// queue an input if there's a slot for it, without waiting
+		bool trySubmit ( std::vector<double>, callback );
+
+		// wait until every request admitted so far has completed
+		void wait ();
+
+		// requests admitted and not yet completed
+		size_t inFlight () const;
+
+		size_t depth () const;
+
+	private:
+
+		struct Request
+		{
+			std::vector<double> input;
+			std::promise<std::vector<double> > promise;
+			callback done;
+		};
+
+		void check ( const std::vector<double>& ) const;
+		void push ( Request );
+		void run ();
+
+		Network& net;
+		ThreadPool& pool;
+		size_t capacity;
+		int batch;
+		size_t widest;
+
+		std::deque<Request> pending;
+		size_t admitted;		// requests queued or running
+		unsigned int runners;	// pool tasks draining 'pending'
+
+		mutable std::mutex mutex;
+		std::condition_variable space;
+		std::condition_variable idle;
+
+	}; // end class InferenceQueue
+}
+
+#endif
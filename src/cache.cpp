@@ -0,0 +1,199 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "cache.h"
+
+namespace machine {
+
+	InferenceCache::InferenceCache ( size_t capacity, unsigned int nShards )
+		: capacity(capacity)
+	{
+		if ( nShards == 0 )
+			nShards = 1;
+
+		this->shardCapacity = capacity / nShards;
+		this->shards = std::vector<Shard*>(nShards);
+
+		for (auto it = this->shards.begin(); it != this->shards.end(); ++it)
+		{
+			(*it) = new Shard();
+			(*it)->bytes = 0;
+			(*it)->hits = (*it)->misses = (*it)->insertions = (*it)->evictions = 0;
+		}
+	}
+
+	InferenceCache::~InferenceCache()
+	{
+		for (auto it = this->shards.begin(); it != this->shards.end(); ++it)
+			delete (*it);
+	}
+
+	/**
+	 * 64 bit hash of the input bytes
+	 *
+	 * the input is consumed one double (8 bytes) at a time, with a multiply / xor-shift mix
+	 * for each word and a final avalanche, which is considerably cheaper than a byte-at-a-time
+	 * hash such as FNV on the long vectors we typically see
+	 */
+	uint64_t InferenceCache::hash ( const std::vector<double>& input, unsigned long long version )
+	{
+		uint64_t h = 0x9E3779B97F4A7C15ULL ^ ( version * 0xC2B2AE3D27D4EB4FULL ) ^ input.size();
+
+		for (auto it = input.begin(); it != input.end(); ++it)
+		{
+			uint64_t k;
+			std::memcpy( &k, &(*it), sizeof(k) );
+
+			k *= 0x87C37B91114253D5ULL;
+			k ^= k >> 31;
+			h ^= k;
+			h = ( h << 27 | h >> 37 ) * 0x4CF5AD432745937FULL;
+		}
+
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+
+		return h;
+	}
+
+	// the number of bytes an entry costs, including the list node and the index node
+	size_t InferenceCache::entryBytes ( size_t nInputs, size_t nOutputs )
+	{
+		return sizeof(Entry) + 2 * sizeof(void*) 						// list node
+			+ sizeof(index_map::value_type) + 2 * sizeof(void*) 		// index node and bucket slot
+			+ ( nInputs + nOutputs ) * sizeof(double);					// payload
+	}
+
+	InferenceCache::Shard& InferenceCache::shard ( uint64_t key )
+	{
+		// the low bits select the bucket inside the shard's map, so use the high bits here
+		return *this->shards[ ( key >> 40 ) % this->shards.size() ];
+	}
+
+	/**
+	 * look up the output for 'input' computed at model 'version'
+	 *
+	 * :return - true on a hit, in which case the cached vector is copied into 'output'
+	 */
+	bool InferenceCache::lookup ( const std::vector<double>& input, unsigned long long version, std::vector<double>& output )
+	{
+		uint64_t key = hash( input, version );
+		Shard& s = this->shard(key);
+
+		std::lock_guard<std::mutex> lock( s.mutex );
+
+		auto range = s.index.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			auto entry = it->second;
+
+			// guard against hash collisions by comparing the full key
+			if ( entry->version == version && entry->input == input )
+			{
+				// move the entry to the front of the LRU list
+				s.lru.splice( s.lru.begin(), s.lru, entry );
+				output = entry->output;
+				++s.hits;
+				return true;
+			}
+		}
+
+		++s.misses;
+		return false;
+	}
+
+	// store the output for 'input' computed at model 'version', evicting the least recently used entries as needed
+	void InferenceCache::insert ( const std::vector<double>& input, unsigned long long version, const std::vector<double>& output )
+	{
+		size_t bytes = entryBytes( input.size(), output.size() );
+
+		// entries that could never fit aren't worth evicting everything else for
+		if ( bytes > this->shardCapacity )
+			return;
+
+		uint64_t key = hash( input, version );
+		Shard& s = this->shard(key);
+
+		std::lock_guard<std::mutex> lock( s.mutex );
+
+		// another thread may have inserted the same result while we were computing it
+		auto range = s.index.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if ( it->second->version == version && it->second->input == input )
+				return;
+		}
+
+		while ( s.bytes + bytes > this->shardCapacity && !s.lru.empty() )
+		{
+			auto victim = std::prev( s.lru.end() );
+
+			auto vrange = s.index.equal_range( victim->key );
+			for (auto it = vrange.first; it != vrange.second; ++it)
+			{
+				if ( it->second == victim )
+				{
+					s.index.erase(it);
+					break;
+				}
+			}
+
+			s.bytes -= victim->bytes;
+			s.lru.erase(victim);
+			++s.evictions;
+		}
+
+		s.lru.push_front( Entry{ key, version, input, output, bytes } );
+		s.index.insert( index_map::value_type( key, s.lru.begin() ) );
+		s.bytes += bytes;
+		++s.insertions;
+	}
+
+	// drop every entry; the counters are kept
+	void InferenceCache::clear ()
+	{
+		for (auto it = this->shards.begin(); it != this->shards.end(); ++it)
+		{
+			std::lock_guard<std::mutex> lock( (*it)->mutex );
+			(*it)->index.clear();
+			(*it)->lru.clear();
+			(*it)->bytes = 0;
+		}
+	}
+
+	InferenceCache::Stats InferenceCache::stats () const
+	{
+		Stats st = { 0, 0, 0, 0, 0, 0, this->capacity };
+
+		for (auto it = this->shards.begin(); it != this->shards.end(); ++it)
+		{
+			std::lock_guard<std::mutex> lock( (*it)->mutex );
+			st.hits += (*it)->hits;
+			st.misses += (*it)->misses;
+			st.insertions += (*it)->insertions;
+			st.evictions += (*it)->evictions;
+			st.entries += (*it)->lru.size();
+			st.bytes += (*it)->bytes;
+		}
+
+		return st;
+	}
+}
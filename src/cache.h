@@ -0,0 +1,109 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									Inference Cache
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * a bounded, sharded LRU cache of feedForward results
+	 *
+	 * entries are keyed on a hash of the raw bytes of the input vector and the version of the
+	 * model that produced the output, so an output computed against old weights can never be
+	 * returned once the weights change. Each shard has its own lock and its own LRU list, so
+	 * concurrent callers only contend when their inputs hash to the same shard.
+	 *
+	 * capacity is expressed in bytes, and counts the payload of the stored vectors as well as
+	 * the bookkeeping overhead of each entry.
+	 *
+	 */
+	class InferenceCache
+	{
+	public:
+
+		// counters are summed over all of the shards
+		struct Stats
+		{
+			unsigned long long hits;
+			unsigned long long misses;
+			unsigned long long insertions;
+			unsigned long long evictions;
+			size_t entries;
+			size_t bytes;
+			size_t capacity;
+		};
+
+		/**
+		 * :param capacity - maximum number of bytes held by the cache
+		 * :param nShards - number of independently locked shards
+		 */
+		InferenceCache ( size_t, unsigned int = 16 );
+		~InferenceCache();
+
+		bool lookup ( const std::vector<double>&, unsigned long long, std::vector<double>& );
+		void insert ( const std::vector<double>&, unsigned long long, const std::vector<double>& );
+		void clear ();
+		Stats stats () const;
+
+		// hash the bytes of an input vector, seeded with the model version
+		static uint64_t hash ( const std::vector<double>&, unsigned long long );
+
+	private:
+
+		struct Entry
+		{
+			uint64_t key;
+			unsigned long long version;
+			std::vector<double> input;
+			std::vector<double> output;
+			size_t bytes;
+		};
+
+		typedef std::list<Entry> lru_list;
+		typedef std::unordered_multimap<uint64_t, lru_list::iterator> index_map;
+
+		struct Shard
+		{
+			mutable std::mutex mutex;
+			lru_list lru;
+			index_map index;
+			size_t bytes;
+			unsigned long long hits;
+			unsigned long long misses;
+			unsigned long long insertions;
+			unsigned long long evictions;
+		};
+
+		Shard& shard ( uint64_t );
+		static size_t entryBytes ( size_t, size_t );
+
+		size_t capacity;
+		size_t shardCapacity;
+		std::vector<Shard*> shards;
+
+	}; // end class InferenceCache
+}
+
+#endif
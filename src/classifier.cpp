@@ -0,0 +1,199 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "network.h"
+#include "classifier.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 			Softmax kernels
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * all of the kernels subtract the maximum before exponentiating, so that exp() can't overflow
+	 * no matter how large the scores are.
+	 *
+	 * the reductions are split over four independent accumulators, which breaks the dependency
+	 * chain between iterations and lets the compiler keep several lanes in flight
+	 */
+
+	// return the largest element of x
+	double maxOf ( const double* x, size_t n )
+	{
+		double m0 = -std::numeric_limits<double>::infinity(), m1 = m0, m2 = m0, m3 = m0;
+		size_t i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			m0 = x[i] > m0 ? x[i] : m0;
+			m1 = x[i+1] > m1 ? x[i+1] : m1;
+			m2 = x[i+2] > m2 ? x[i+2] : m2;
+			m3 = x[i+3] > m3 ? x[i+3] : m3;
+		}
+
+		for (; i < n; ++i)
+			m0 = x[i] > m0 ? x[i] : m0;
+
+		m0 = m1 > m0 ? m1 : m0;
+		m2 = m3 > m2 ? m3 : m2;
+		return m2 > m0 ? m2 : m0;
+	}
+
+	// return log( sum( exp(x) ) ), computed as max + log( sum( exp(x - max) ) )
+	double logSumExp ( const double* x, size_t n )
+	{
+		double m = maxOf( x, n );
+		double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		size_t i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			s0 += std::exp( x[i] - m );
+			s1 += std::exp( x[i+1] - m );
+			s2 += std::exp( x[i+2] - m );
+			s3 += std::exp( x[i+3] - m );
+		}
+
+		for (; i < n; ++i)
+			s0 += std::exp( x[i] - m );
+
+		return m + std::log( (s0 + s1) + (s2 + s3) );
+	}
+
+	// write softmax(x) into out; x and out may alias
+	void softmax ( const double* x, size_t n, double* out )
+	{
+		double lse = logSumExp( x, n );
+
+		for (size_t i = 0; i < n; ++i)
+			out[i] = std::exp( x[i] - lse );
+	}
+
+	// write log(softmax(x)) into out; x and out may alias
+	void logSoftmax ( const double* x, size_t n, double* out )
+	{
+		double lse = logSumExp( x, n );
+
+		for (size_t i = 0; i < n; ++i)
+			out[i] = x[i] - lse;
+	}
+
+	/**
+	 * fused softmax + cross-entropy
+	 *
+	 * computes the loss -log(softmax(x)[target]) and its gradient with respect to x,
+	 * softmax(x) - onehot(target), without ever storing the probabilities themselves
+	 *
+	 * :param x - scores
+	 * :param n - number of classes
+	 * :param target - index of the correct class
+	 * :param grad - output for the gradient (may alias x, or be nullptr if only the loss is needed)
+	 * :return - the loss
+	 */
+	double softmaxCrossEntropy ( const double* x, size_t n, size_t target, double* grad )
+	{
+		double lse = logSumExp( x, n );
+		double loss = lse - x[target];
+
+		if ( grad )
+		{
+			for (size_t i = 0; i < n; ++i)
+				grad[i] = std::exp( x[i] - lse );
+
+			grad[target] -= 1;
+		}
+
+		return loss;
+	}
+
+	/**
+	 * fused softmax + cross-entropy against target probabilities, rather than a single class
+	 *
+	 * computes the loss -sum( target * log(softmax(x)) ) and its gradient with respect to x,
+	 * softmax(x) - target, for targets that sum to one
+	 *
+	 * :param x - scores
+	 * :param n - number of classes
+	 * :param target - probability of each class
+	 * :param grad - output for the gradient (may alias x, or be nullptr if only the loss is needed)
+	 * :return - the loss
+	 */
+	double softmaxCrossEntropy ( const double* x, size_t n, const double* target, double* grad )
+	{
+		double lse = logSumExp( x, n );
+		double loss = 0;
+
+		for (size_t i = 0; i < n; ++i)
+			loss += target[i] * ( lse - x[i] );
+
+		if ( grad )
+			for (size_t i = 0; i < n; ++i)
+				grad[i] = std::exp( x[i] - lse ) - target[i];
+
+		return loss;
+	}
+
+	// index of the largest element; softmax is monotonic, so this is also the most probable class
+	size_t argmax ( const double* x, size_t n )
+	{
+		size_t best = 0;
+
+		for (size_t i = 1; i < n; ++i)
+			if ( x[i] > x[best] )
+				best = i;
+
+		return best;
+	}
+
+	/**
+	 * find the indices of the k largest elements of x, in descending order
+	 *
+	 * keeps a sorted buffer of k candidates and only does any work for elements that beat the
+	 * current k-th best, so for k << n this is a single pass over x
+	 *
+	 * :param idx - output buffer of at least k indices
+	 * :return - the number of indices written, min(k, n)
+	 */
+	size_t topK ( const double* x, size_t n, size_t k, size_t* idx )
+	{
+		if ( k > n )
+			k = n;
+
+		if ( k == 0 )
+			return 0;
+
+		size_t filled = 0;
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			if ( filled == k && !( x[i] > x[ idx[k-1] ] ) )
+				continue;
+
+			// insertion sort into the candidate buffer
+			size_t j = filled < k ? filled++ : k - 1;
+			while ( j > 0 && x[ idx[j-1] ] < x[i] )
+			{
+				idx[j] = idx[j-1];
+				--j;
+			}
+			idx[j] = i;
+		}
+
+		return filled;
+	}
+}
@@ -1,34 +1,188 @@
 #ifndef CLASSIFIER_H
-#define CLASSIFIER_H	
+#define CLASSIFIER_H
 
 #include <typeinfo>
 #include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "network.h"
 
 namespace machine {
 
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 			Softmax kernels
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * defined in 'classifier.cpp'
+	 *
+	 */
+	double maxOf ( const double*, size_t );
+	double logSumExp ( const double*, size_t );
+	void softmax ( const double*, size_t, double* );
+	void logSoftmax ( const double*, size_t, double* );
+	double softmaxCrossEntropy ( const double*, size_t, size_t, double* );
+	double softmaxCrossEntropy ( const double*, size_t, const double*, double* );
+	size_t argmax ( const double*, size_t );
+	size_t topK ( const double*, size_t, size_t, size_t* );
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									Classifier
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * treats the outputs of a Network as the scores of a softmax classifier
+	 *
+	 * the network has to be built with Parameters::softmaxOutput, so that its outputs are the sums
+	 * of its output layer; the output of a bounded activation function (like the sigmoid's, in (0,1))
+	 * would cap how confident the probabilities could ever get
+	 *
+	 * output neuron i is the score of the class labels[i], where the labels are of type T.
+	 * By default the labels are just the output indices (0, 1, 2 ...)
+	 *
+	 * predict and topK only ever look at the scores; since softmax is monotonic the ranking
+	 * of the scores is the ranking of the probabilities, so the full probability vector is never built
+	 *
+	 */
 	template<class T> class Classifier
 	{
 	public:
-		Classifier( Network& net )
+
+		// a label, and the probability the classifier assigns to it
+		typedef std::pair<T, double> scored_label;
+
+		Classifier( Network& net ) : net(net)
+		{
+			check( net );
+			this->labels.reserve( net.outputs() );
+
+			for (int i = 0; i < net.outputs(); ++i)
+				this->labels.push_back( static_cast<T>(i) );
+		}
+
+		Classifier( Network& net, std::vector<T> labels ) : net(net), labels(labels)
+		{
+			check( net );
+			if ( (int)this->labels.size() != net.outputs() )
+				throw std::invalid_argument("Classifier: expected one label per network output");
+		}
+
+		// probabilities of the scores in 'vec'
+		std::vector<double> softmax ( std::vector<double> vec )
+		{
+			machine::softmax( vec.data(), vec.size(), vec.data() );
+			return vec;
+		}
+
+		// log-probabilities of the scores in 'vec'
+		std::vector<double> logSoftmax ( std::vector<double> vec )
+		{
+			machine::logSoftmax( vec.data(), vec.size(), vec.data() );
+			return vec;
+		}
+
+		// probabilities of every class for 'input'
+		std::vector<double> probabilities ( std::vector<double> input )
+		{
+			return this->softmax( this->net.feedForward(input) );
+		}
+
+		// cross-entropy loss of 'input' against 'label', without training
+		double loss ( std::vector<double> input, const T& label )
+		{
+			std::vector<double> scores = this->net.feedForward(input);
+			return softmaxCrossEntropy( scores.data(), scores.size(), this->indexOf(label), nullptr );
+		}
+
+		/**
+		 * train the network on a single labelled example, minimizing the softmax cross-entropy
+		 *
+		 * the target is the one-hot vector of the label; the training function takes the gradient,
+		 * softmax(scores) - target, from the scores of its own forward pass, and hands them back
+		 *
+		 * :return - the loss before the update
+		 */
+		double train ( std::vector<double> input, const T& label )
 		{
+			const size_t target = this->indexOf(label);
+			std::vector<double> expected( this->labels.size(), 0.0 );
+			expected[target] = 1;
 
+			std::vector<double> scores = this->net.train( input, expected );
+			return softmaxCrossEntropy( scores.data(), scores.size(), target, nullptr );
 		}
 
-		std::vector<double> softmax ( std::vector<double> )
+		// the most probable label for 'input'
+		T predict ( std::vector<double> input )
 		{
-						
+			std::vector<double> scores = this->net.feedForward(input);
+			return this->labels[ argmax( scores.data(), scores.size() ) ];
 		}
 
-		// softmax = function ( vec ) {
-		// var sum = vec.reduce(function ( prev, cur ) {
-		// 	return prev + Math.exp(cur);
-		// },0);
+		// the most probable label for each input in 'batch'
+		std::vector<T> predict ( const std::vector<std::vector<double> >& batch )
+		{
+			std::vector<std::vector<double> > scores = this->net.feedForward(batch);
+			std::vector<T> result;
+			result.reserve( batch.size() );
+
+			for (auto it = scores.begin(); it != scores.end(); ++it)
+				result.push_back( this->labels[ argmax( it->data(), it->size() ) ] );
+
+			return result;
+		}
+
+		/**
+		 * the k most probable labels for each input in 'batch', most probable first
+		 *
+		 * only the probabilities of the k winners are computed, from the log-sum-exp of the scores
+		 */
+		std::vector<std::vector<scored_label> > topK ( const std::vector<std::vector<double> >& batch, size_t k )
+		{
+			std::vector<std::vector<scored_label> > result( batch.size() );
+			std::vector<std::vector<double> > outputs = this->net.feedForward(batch);
+			std::vector<size_t> idx(k);
+
+			for (size_t b = 0; b < batch.size(); ++b)
+			{
+				const std::vector<double>& scores = outputs[b];
+				size_t found = machine::topK( scores.data(), scores.size(), k, idx.data() );
+				double lse = logSumExp( scores.data(), scores.size() );
+
+				result[b].reserve(found);
+				for (size_t i = 0; i < found; ++i)
+					result[b].push_back( scored_label( this->labels[ idx[i] ], std::exp( scores[ idx[i] ] - lse ) ) );
+			}
+
+			return result;
+		}
+
+		const std::vector<T>& classes () const
+		{
+			return this->labels;
+		}
+
+	private:
+
+		static void check ( const Network& net )
+		{
+			if ( !net.softmaxOutput() )
+				throw std::invalid_argument("Classifier: the network has to be built with Parameters::softmaxOutput");
+		}
+
+		size_t indexOf ( const T& label ) const
+		{
+			auto it = std::find( this->labels.begin(), this->labels.end(), label );
+
+			if ( it == this->labels.end() )
+				throw std::invalid_argument("Classifier: unknown label");
+
+			return it - this->labels.begin();
+		}
 
-		// return vec.map( function ( val, i ) {
-		// 	return Math.exp( val ) / sum;
-		// });
-		
+		Network& net;
+		std::vector<T> labels;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
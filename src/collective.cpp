@@ -0,0 +1,368 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "collective.h"
+
+namespace machine {
+
+	Communicator::~Communicator()
+	{}
+
+	// everyone but the root adds zeros, which leaves the root's values exactly as they were
+	void Communicator::broadcast ( double* data, size_t n, int root )
+	{
+		if ( this->rank() != root )
+			std::fill( data, data + n, 0.0 );
+
+		this->allreduce( data, n );
+	}
+
+	void Communicator::barrier ()
+	{
+		double token = 0;
+		this->allreduce( &token, 1 );
+	}
+
+	/**
+	 * the segment starts with this header, on a cache line of its own, followed by each member's
+	 * step counter on a line of its own, and then each member's buffer
+	 */
+	struct SharedMemoryRing::Header
+	{
+		std::atomic<int> failed;
+		int size;
+		uint64_t capacity;
+	};
+
+	static const size_t cacheLine = 64;
+
+	static size_t segmentBytes ( int size, size_t capacity )
+	{
+		return cacheLine * ( 1 + size ) + size * capacity * sizeof(double);
+	}
+
+	static std::runtime_error systemError ( const std::string& what )
+	{
+		return std::runtime_error( "SharedMemoryRing: " + what + ": " + std::strerror(errno) );
+	}
+
+	void SharedMemoryRing::create ( const std::string& name, int size, size_t capacity )
+	{
+		if ( size < 1 || capacity < 1 )
+			throw std::invalid_argument("SharedMemoryRing: a group needs at least one member and some buffer");
+
+		const size_t length = segmentBytes( size, capacity );
+
+		int fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+		if ( fd < 0 )
+			throw systemError("can't create " + name);
+
+		if ( ftruncate( fd, length ) != 0 )
+		{
+			std::runtime_error error = systemError("can't size " + name);
+			close(fd);
+			shm_unlink( name.c_str() );
+			throw error;
+		}
+
+		void* p = mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		close(fd);
+		if ( p == MAP_FAILED )
+		{
+			std::runtime_error error = systemError("can't map " + name);
+			shm_unlink( name.c_str() );
+			throw error;
+		}
+
+		char* base = static_cast<char*>(p);
+		Header* header = new (base) Header();
+		header->failed = 0;
+		header->size = size;
+		header->capacity = capacity;
+
+		for (int r = 0; r < size; ++r)
+			new ( base + cacheLine * ( 1 + r ) ) std::atomic<uint64_t>(0);
+
+		munmap( p, length );
+	}
+
+	void SharedMemoryRing::destroy ( const std::string& name )
+	{
+		shm_unlink( name.c_str() );
+	}
+
+	/**
+	 * :param name - the name the segment was created with
+	 * :param rank - this process's place in the group
+	 */
+	SharedMemoryRing::SharedMemoryRing ( const std::string& name, int rank )
+		: base(nullptr), length(0), header(nullptr), member(rank), members(0), capacity(0), steps(0)
+	{
+		int fd = shm_open( name.c_str(), O_RDWR, 0600 );
+		if ( fd < 0 )
+			throw systemError("can't open " + name);
+
+		struct stat info;
+		if ( fstat( fd, &info ) != 0 || (size_t)info.st_size < cacheLine )
+		{
+			close(fd);
+			throw std::runtime_error("SharedMemoryRing: " + name + " isn't a group's segment");
+		}
+
+		void* p = mmap( nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		close(fd);
+		if ( p == MAP_FAILED )
+			throw systemError("can't map " + name);
+
+		this->base = static_cast<char*>(p);
+		this->length = info.st_size;
+		this->header = reinterpret_cast<Header*>( this->base );
+		this->members = this->header->size;
+		this->capacity = this->header->capacity;
+
+		if ( rank < 0 || rank >= this->members || this->length < segmentBytes( this->members, this->capacity ) )
+		{
+			munmap( this->base, this->length );
+			throw std::out_of_range("SharedMemoryRing: no such member of the group");
+		}
+	}
+
+	SharedMemoryRing::~SharedMemoryRing()
+	{
+		munmap( this->base, this->length );
+	}
+
+	int SharedMemoryRing::rank () const
+	{
+		return this->member;
+	}
+
+	int SharedMemoryRing::size () const
+	{
+		return this->members;
+	}
+
+	void SharedMemoryRing::abort ()
+	{
+		this->header->failed.store(1);
+	}
+
+	std::atomic<uint64_t>& SharedMemoryRing::progress ( int r ) const
+	{
+		return *reinterpret_cast<std::atomic<uint64_t>*>( this->base + cacheLine * ( 1 + r ) );
+	}
+
+	double* SharedMemoryRing::buffer ( int r ) const
+	{
+		return reinterpret_cast<double*>( this->base + cacheLine * ( 1 + this->members ) ) + r * this->capacity;
+	}
+
+	void SharedMemoryRing::allreduce ( double* data, size_t n )
+	{
+		if ( this->members < 2 )
+			return;
+
+		for (size_t offset = 0; offset < n; offset += this->capacity)
+			this->reduce( data + offset, std::min( this->capacity, n - offset ) );
+	}
+
+	// ring allreduce of m <= capacity doubles
+	void SharedMemoryRing::reduce ( double* data, size_t m )
+	{
+		const int n = this->members;
+		double* mine = this->buffer( this->member );
+		const double* left = this->buffer( ( this->member + n - 1 ) % n );
+
+		// chunk c of the data is [ m * c / n, m * (c + 1) / n )
+		auto chunk = [&]( int c, size_t& lo, size_t& hi ) {
+			c = ( ( c % n ) + n ) % n;
+			lo = m * c / n;
+			hi = m * ( c + 1 ) / n;
+		};
+
+		size_t lo, hi;
+
+		this->sync();
+		std::copy( data, data + m, mine );
+		this->finish();
+
+		// reduce-scatter: afterwards this member's chunk (rank + 1) holds the sum over the group
+		for (int s = 0; s < n - 1; ++s)
+		{
+			this->sync();
+			chunk( this->member - 1 - s, lo, hi );
+			for (size_t i = lo; i < hi; ++i)
+				mine[i] += left[i];
+			this->finish();
+		}
+
+		// allgather: pass the summed chunks round the ring
+		for (int s = 0; s < n - 1; ++s)
+		{
+			this->sync();
+			chunk( this->member - s, lo, hi );
+			std::copy( left + lo, left + hi, mine + lo );
+			this->finish();
+		}
+
+		std::copy( mine, mine + m, data );
+	}
+
+	/**
+	 * wait for both neighbours to have finished as many steps as this member: the left one has
+	 * then written what this step reads, and the right one has read what this step overwrites
+	 *
+	 * spin for a short wait, then yield, then sleep, in case a neighbour has been descheduled
+	 */
+	void SharedMemoryRing::sync ()
+	{
+		const int n = this->members;
+		const int neighbours[2] = { ( this->member + n - 1 ) % n, ( this->member + 1 ) % n };
+
+		for (int k = 0; k < 2; ++k)
+		{
+			std::atomic<uint64_t>& peer = this->progress( neighbours[k] );
+			unsigned int idle = 0;
+
+			while ( peer.load( std::memory_order_acquire ) < this->steps )
+			{
+				if ( this->header->failed.load( std::memory_order_relaxed ) )
+					throw std::runtime_error("SharedMemoryRing: another member of the group failed");
+
+				if ( ++idle > 65536 )
+					std::this_thread::sleep_for( std::chrono::microseconds(50) );
+				else if ( idle > 64 )
+					std::this_thread::yield();
+			}
+		}
+	}
+
+	void SharedMemoryRing::finish ()
+	{
+		this->progress( this->member ).store( ++this->steps, std::memory_order_release );
+	}
+
+	bool launch ( int workers, std::function<void( Communicator& )> fn, size_t capacity )
+	{
+		static std::atomic<int> launches(0);
+		const std::string name = "/machine." + std::to_string( getpid() ) + "." + std::to_string( launches++ );
+
+		SharedMemoryRing::create( name, workers, capacity );
+
+		// the launcher's own view of the segment, to abort the group if a worker dies
+		SharedMemoryRing group( name, 0 );
+		std::vector<pid_t> children;
+		bool ok = true;
+
+		// anything still buffered would otherwise be written out again by every worker
+		std::fflush(nullptr);
+
+		for (int rank = 0; rank < workers; ++rank)
+		{
+			const pid_t pid = fork();
+
+			if ( pid < 0 )
+			{
+				ok = false;
+				group.abort();
+				break;
+			}
+
+			if ( pid == 0 )
+			{
+				int status = 0;
+
+				try
+				{
+					SharedMemoryRing ring( name, rank );
+
+					try
+					{
+						fn(ring);
+					}
+					catch ( ... )
+					{
+						ring.abort();
+						throw;
+					}
+				}
+				catch ( std::exception& e )
+				{
+					std::fprintf( stderr, "worker %d: %s\n", rank, e.what() );
+					status = 1;
+				}
+				catch ( ... )
+				{
+					status = 1;
+				}
+
+				std::fflush( stdout );
+				std::fflush( stderr );
+				_exit(status);
+			}
+
+			children.push_back(pid);
+		}
+
+		// poll each worker, rather than waiting on any child, so other children of the caller are left alone
+		while ( !children.empty() )
+		{
+			bool reaped = false;
+
+			for (auto it = children.begin(); it != children.end(); )
+			{
+				int status;
+				const pid_t pid = waitpid( *it, &status, WNOHANG );
+
+				if ( pid == 0 || ( pid < 0 && errno == EINTR ) )
+				{
+					++it;
+					continue;
+				}
+
+				if ( pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 )
+				{
+					ok = false;
+					group.abort();
+				}
+
+				it = children.erase(it);
+				reaped = true;
+			}
+
+			if ( !reaped )
+				std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+		}
+
+		SharedMemoryRing::destroy(name);
+		return ok;
+	}
+}
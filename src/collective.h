@@ -0,0 +1,137 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef COLLECTIVE_H
+#define COLLECTIVE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Communicator
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * a group of processes training copies of the same network, each on its own shard of the data
+	 *
+	 * every member must make the same calls in the same order, with the same lengths. 'allreduce'
+	 * leaves every member with bit-for-bit the same sums, so copies that start out the same and
+	 * step with the reduced gradients stay the same.
+	 *
+	 */
+	class Communicator
+	{
+	public:
+
+		virtual ~Communicator();
+
+		// this process's place in the group, from 0 to size() - 1
+		virtual int rank () const = 0;
+		virtual int size () const = 0;
+
+		// replace 'data' with its sum over every member of the group
+		virtual void allreduce ( double*, size_t ) = 0;
+
+		// replace 'data' with that of the member 'root'
+		void broadcast ( double*, size_t, int );
+
+		// wait until every member of the group has got here
+		void barrier ();
+
+	}; // end class Communicator
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Shared Memory Ring
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * a Communicator for processes on one host, through a POSIX shared memory segment
+	 *
+	 * each member has a buffer of 'capacity' doubles in the segment, and a counter of the steps
+	 * it has finished. 'allreduce' is a ring allreduce: the data is cut into one chunk per member,
+	 * and in each of size - 1 steps every member adds a chunk of its left neighbour's buffer into
+	 * its own (reduce-scatter), after which each member holds one fully summed chunk; in size - 1
+	 * more steps the summed chunks are copied round the ring (allgather). Each member reads and
+	 * writes 2 (size - 1) / size of the data, however many members there are.
+	 *
+	 * the members move in lock step, each waiting for both neighbours to finish the step before,
+	 * so nothing is overwritten before it's been read. Longer data is reduced 'capacity' at a time.
+	 * If a member fails, 'abort' marks the whole group failed, and the others throw instead of
+	 * waiting for it forever.
+	 *
+	 */
+	class SharedMemoryRing : public Communicator
+	{
+	public:
+
+		// make the segment for a group of 'size' members, with 'capacity' doubles of buffer each
+		static void create ( const std::string&, int, size_t = 1 << 18 );
+
+		// remove the segment's name; members that have it open keep it until they close it
+		static void destroy ( const std::string& );
+
+		// join the group made by 'create' as member 'rank'
+		SharedMemoryRing ( const std::string&, int );
+		~SharedMemoryRing();
+
+		int rank () const;
+		int size () const;
+		void allreduce ( double*, size_t );
+
+		// mark the group failed
+		void abort ();
+
+	private:
+
+		SharedMemoryRing ( const SharedMemoryRing& );
+		SharedMemoryRing& operator= ( const SharedMemoryRing& );
+
+		struct Header;
+
+		std::atomic<uint64_t>& progress ( int ) const;
+		double* buffer ( int ) const;
+		void reduce ( double*, size_t );
+		void sync ();
+		void finish ();
+
+		char* base;
+		size_t length;
+		Header* header;
+		int member;
+		int members;
+		size_t capacity;
+		uint64_t steps;		// steps this member has finished
+
+	}; // end class SharedMemoryRing
+
+	/**
+	 * run fn in 'workers' forked processes, joined by a SharedMemoryRing, and wait for them all
+	 *
+	 * if a worker throws or dies, the rest of the group is aborted. Call this before starting any
+	 * threads (including the thread pool's), since only the thread calling fork carries on in the
+	 * workers.
+	 *
+	 * :param workers - number of processes
+	 * :param fn - the work of each process, given its member of the group
+	 * :param capacity - doubles of shared buffer per worker
+	 * :return - true if every worker returned from fn
+	 */
+	bool launch ( int, std::function<void( Communicator& )>, size_t = 1 << 18 );
+}
+
+#endif
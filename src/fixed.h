@@ -0,0 +1,226 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "network.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 		Fixed activation functions
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * the built in activation functions as types, so that a FixedNetwork can inline them
+	 *
+	 * each one is the same expression as its counterpart in 'network-fun.cpp', so the two give
+	 * identical results; 'name' is matched against ActFunction::name when copying a Network
+	 */
+	namespace fixed {
+
+		struct Sigmoid
+		{
+			static const char* name () { return "sigmoid"; }
+			static double dxdy ( double x ) { return 1 / ( 1 + exp(-x) ); }
+		};
+
+		struct Softplus
+		{
+			static const char* name () { return "softplus"; }
+			static double dxdy ( double x ) { return log10( 1 + exp(x) ); }
+		};
+
+		struct HyperbolicTan
+		{
+			static const char* name () { return "hyperbolic_tan"; }
+			static double dxdy ( double x ) { return tanh(x); }
+		};
+
+		// copy the row-major weights of 'layer' into column-major 'weights'
+		template<int In, int Out> void copyLayer ( Network::Layer& layer, std::array<double, In * Out>& weights )
+		{
+			if ( layer.size() != Out || (int)layer.weights.size() != In * Out )
+				throw std::invalid_argument("FixedNetwork: layer " + std::to_string(layer.index) + " doesn't match the fixed topology");
+
+			for (int i = 0; i < Out; ++i)
+				for (int j = 0; j < In; ++j)
+					weights[ j * Out + i ] = layer.weights[ i * In + j ];
+		}
+
+		template<class Act, int In, int Out> void propogate ( const std::array<double, In * Out>& weights, const double* input, double* output )
+		{
+			double sum[Out] = {};
+
+			for (int j = 0; j < In; ++j)
+			{
+				const double x = input[j];
+				const double* column = weights.data() + j * Out;
+
+				for (int i = 0; i < Out; ++i)
+					sum[i] += x * column[i];
+			}
+
+			for (int i = 0; i < Out; ++i)
+				output[i] = Act::dxdy( sum[i] );
+		}
+
+		/**
+		 * one fully connected layer of 'In' inputs and 'Out' neurons, followed by the rest of the network
+		 *
+		 * the weights are stored column-major (In x Out), so the inner loop runs across the neurons
+		 * with one independent accumulator each; that loop vectorizes, while every neuron still sums
+		 * its inputs in order 0..In-1, the same as dot() does for the Network.
+		 */
+		template<class Act, int In, int Out, int... Rest> struct Layers
+		{
+			static const int outputs = Layers<Act, Out, Rest...>::outputs;
+
+			void copy ( Network::iterator it )
+			{
+				copyLayer<In, Out>( *it, this->weights );
+				++it;
+				this->next.copy( it );
+			}
+
+			void forward ( const double* input, double* output ) const
+			{
+				alignas(64) double hidden[Out];
+				propogate<Act, In, Out>( this->weights, input, hidden );
+				this->next.forward( hidden, output );
+			}
+
+			std::array<double, In * Out> weights;
+			Layers<Act, Out, Rest...> next;
+		};
+
+		// the output layer
+		template<class Act, int In, int Out> struct Layers<Act, In, Out>
+		{
+			static const int outputs = Out;
+
+			void copy ( Network::iterator it )
+			{
+				copyLayer<In, Out>( *it, this->weights );
+			}
+
+			void forward ( const double* input, double* output ) const
+			{
+				propogate<Act, In, Out>( this->weights, input, output );
+			}
+
+			std::array<double, In * Out> weights;
+		};
+
+		// the first of a list of sizes, ie. the number of inputs
+		template<int First, int... Rest> struct first
+		{
+			static const int value = First;
+		};
+	}
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									FixedNetwork
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * an inference only copy of a trained Network, with its topology fixed at compile time
+	 *
+	 * the sizes follow Parameters::layerSizes: the number of inputs, then the width of each layer,
+	 * so a network built with layerSizes({16, 32, 4}) is copied into a
+	 *
+	 * 		FixedNetwork<fixed::Sigmoid, 16, 32, 4>
+	 *
+	 * (the default topology starts with a square input layer, so its sizes are inputs, inputs, the
+	 * hidden sizes, then outputs)
+	 *
+	 * every loop bound is a constant and the weights live inline in std::arrays, so the compiler
+	 * can unroll the whole forward pass and keep it on the stack; nothing is allocated per call.
+	 * The weights are only aligned as doubles, so that a FixedNetwork can be allocated with 'new'
+	 * (C++11's operator new doesn't honour anything wider than alignof(std::max_align_t)).
+	 *
+	 * the output is bit-for-bit the same as Network::feedForward, as long as neither is built with
+	 * -ffast-math or -ffp-contract=fast (either lets the compiler reassociate or fuse the sums)
+	 *
+	 */
+	template<class Act, int... Sizes> class FixedNetwork
+	{
+	public:
+
+		static const int inputs = fixed::first<Sizes...>::value;
+
+		static const int outputs = fixed::Layers<Act, Sizes...>::outputs;
+
+		static const int depth = sizeof...(Sizes) - 1;
+
+		/**
+		 * copy the weights of 'net'
+		 *
+		 * throws std::invalid_argument if the layers, the activation function or the propogation
+		 * function of 'net' don't match this type
+		 */
+		FixedNetwork ( Network& net )
+		{
+			if ( net.size() != depth )
+				throw std::invalid_argument("FixedNetwork: expected " + std::to_string(depth) + " layers");
+
+			if ( net.activate().name != Act::name() )
+				throw std::invalid_argument("FixedNetwork: the network's activation function isn't " + std::string( Act::name() ));
+
+			if ( net.softmaxOutput() )
+				throw std::invalid_argument("FixedNetwork: a network with softmax outputs has no activation on its output layer");
+
+			for (auto it = net.begin(); it != net.end(); ++it)
+				if ( it->kernel == Network::Layer::Generic )
+					throw std::invalid_argument("FixedNetwork: only networks using the dot product propogation function can be fixed");
+
+			this->layers.copy( net.begin() );
+		}
+
+		std::array<double, outputs> feedForward ( const std::array<double, inputs>& input ) const
+		{
+			std::array<double, outputs> output;
+			this->layers.forward( input.data(), output.data() );
+			return output;
+		}
+
+		std::vector<double> feedForward ( const std::vector<double>& input ) const
+		{
+			if ( (int)input.size() != inputs )
+				throw std::invalid_argument("FixedNetwork: expected " + std::to_string(inputs) + " inputs");
+
+			std::vector<double> output( outputs );
+			this->layers.forward( input.data(), output.data() );
+			return output;
+		}
+
+		// raw version for callers that manage their own buffers
+		void forward ( const double* input, double* output ) const
+		{
+			this->layers.forward( input, output );
+		}
+
+	private:
+
+		fixed::Layers<Act, Sizes...> layers;
+
+	}; // end class FixedNetwork
+}
+
+#endif
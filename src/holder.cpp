@@ -0,0 +1,124 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <functional>
+#include <thread>
+
+#include "holder.h"
+
+namespace machine {
+
+	// the stripe of the reader counts the calling thread uses, picked once per thread
+	static int stripeOfThread ( int stripes )
+	{
+		static thread_local int stripe = std::hash<std::thread::id>()( std::this_thread::get_id() ) % stripes;
+		return stripe;
+	}
+
+	// published networks are only ever read, so they're switched out of training mode, where
+	// feedForward would write to the activation arena
+	static Network* readOnly ( Network* net )
+	{
+		if ( net->trainingMode() )
+			net->toggleTrainingMode();
+
+		return net;
+	}
+
+	ModelHolder::ModelHolder ( Network* net )
+		: period(0), readers(stripes)
+	{
+		for (auto it = this->readers.begin(); it != this->readers.end(); ++it)
+			it->count[0] = it->count[1] = 0;
+
+		Snapshot* snapshot = new Snapshot();
+		snapshot->net = readOnly(net);
+		snapshot->version = 1;
+		this->current = snapshot;
+	}
+
+	ModelHolder::~ModelHolder()
+	{
+		Snapshot* snapshot = this->current.load();
+		delete snapshot->net;
+		delete snapshot;
+	}
+
+	/**
+	 * count this reader in the current grace period, then read the pointer; the count is what
+	 * stops a publisher from deleting the network while it's read
+	 */
+	ModelHolder::Reader::Reader ( const ModelHolder& holder ) : holder(holder)
+	{
+		Stripe& stripe = holder.readers[ stripeOfThread( stripes ) ];
+
+		this->count = &stripe.count[ holder.period.load() & 1 ];
+		this->count->fetch_add(1);
+		this->snapshot = holder.current.load();
+	}
+
+	ModelHolder::Reader::~Reader()
+	{
+		this->count->fetch_sub(1);
+	}
+
+	std::vector<double> ModelHolder::feedForward ( const std::vector<double>& input )
+	{
+		Reader reader( *this );
+		return reader->feedForward( input );
+	}
+
+	unsigned long long ModelHolder::version () const
+	{
+		return this->current.load()->version;
+	}
+
+	unsigned long long ModelHolder::publish ( Network* net )
+	{
+		std::lock_guard<std::mutex> lock( this->writer );
+
+		Snapshot* next = new Snapshot();
+		next->net = readOnly(net);
+		next->version = this->current.load()->version + 1;
+
+		Snapshot* previous = this->current.exchange( next );
+
+		// a reader that read the period just before a flip can still count itself in the old parity
+		// after the flip, and may then have read either pointer; draining both parities in turn
+		// catches it wherever it ended up
+		this->drain( this->period.fetch_add(1) & 1 );
+		this->drain( this->period.fetch_add(1) & 1 );
+
+		delete previous->net;
+		delete previous;
+		return next->version;
+	}
+
+	// wait for the readers counted in 'parity' to finish; new readers are counted in the other one
+	void ModelHolder::drain ( int parity )
+	{
+		for (;;)
+		{
+			long active = 0;
+			for (auto it = this->readers.begin(); it != this->readers.end(); ++it)
+				active += it->count[parity].load();
+
+			if ( active == 0 )
+				return;
+
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,125 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef HOLDER_H
+#define HOLDER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "network.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									Model Holder
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * serves inference from a network that can be replaced while it's being read (read-copy-update)
+	 *
+	 * a published network is never modified again: to change the model, train or load a new
+	 * Network and publish it, or keep training one network and publish its 'snapshot'. Readers
+	 * pick up whichever network is current when they start, and finish on it even if a new one is
+	 * published in the meantime; the old network is deleted once the last reader that could have
+	 * seen it is done.
+	 *
+	 * readers take no locks. Each one counts itself in one of two reader counts (picked by the
+	 * parity of the grace period), striped over cache lines so that readers on different threads
+	 * don't share one; 'publish' swaps the pointer, then flips the parity and waits for the old
+	 * count to drain, twice, after which no reader can still hold the old network. Only the
+	 * publisher ever waits.
+	 *
+	 */
+	class ModelHolder
+	{
+		// a published network, and its version
+		struct Snapshot
+		{
+			Network* net;
+			unsigned long long version;
+		};
+
+	public:
+
+		// takes ownership of 'net'; the Parameters it was built from have to outlive it
+		explicit ModelHolder ( Network* );
+		~ModelHolder();
+
+		/**
+		 * a read-side critical section: the network it gives access to stays alive, and
+		 * unchanged, until the Reader is destroyed
+		 *
+		 * readers can nest, but shouldn't be held across a call to 'publish' on the same thread
+		 */
+		class Reader
+		{
+		public:
+
+			explicit Reader ( const ModelHolder& );
+			~Reader();
+
+			Network& operator* () const { return *this->snapshot->net; }
+			Network* operator-> () const { return this->snapshot->net; }
+
+			// the version of the network being read
+			unsigned long long version () const { return this->snapshot->version; }
+
+		private:
+
+			Reader ( const Reader& );
+			Reader& operator= ( const Reader& );
+
+			const ModelHolder& holder;
+			std::atomic<long>* count;
+			Snapshot* snapshot;
+		};
+
+		// feedForward on the current network
+		std::vector<double> feedForward ( const std::vector<double>& );
+
+		/**
+		 * make 'net' the current network, taking ownership of it, and delete the previous one once
+		 * no reader can be using it; returns the new version
+		 */
+		unsigned long long publish ( Network* );
+
+		// the number of networks published so far, counting the first
+		unsigned long long version () const;
+
+	private:
+
+		ModelHolder ( const ModelHolder& );
+		ModelHolder& operator= ( const ModelHolder& );
+
+		static const int stripes = 64;
+
+		struct Stripe
+		{
+			std::atomic<long> count[2];
+			char pad[ 64 - 2 * sizeof(std::atomic<long>) ];
+		};
+
+		void drain ( int );
+
+		std::atomic<Snapshot*> current;
+		std::atomic<unsigned long long> period;
+		mutable std::vector<Stripe> readers;
+		std::mutex writer;
+
+	}; // end class ModelHolder
+}
+
+#endif
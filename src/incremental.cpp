@@ -0,0 +1,151 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include "network.h"
+#include "incremental.h"
+
+namespace machine {
+
+	/**
+	 * :param net - the network to score with
+	 * :param refresh - number of updates between full recomputes
+	 */
+	IncrementalSession::IncrementalSession ( Network& net, int refresh )
+		: net(net), refresh( refresh > 0 ? refresh : 1 ), updates(0), version(0), ready(false)
+	{
+		for (auto it = net.begin(); it != net.end(); ++it)
+			if ( it->kernel == Network::Layer::Generic )
+				throw std::invalid_argument("IncrementalSession: only networks using the dot product propogation function can be updated incrementally");
+
+		this->x.resize( net.inputs() );
+		this->reshape();
+	}
+
+	const std::vector<double>& IncrementalSession::evaluate ( const std::vector<double>& input )
+	{
+		if ( (int)input.size() != this->net.inputs() )
+			throw std::invalid_argument("IncrementalSession: expected " + std::to_string( this->net.inputs() ) + " inputs");
+
+		this->x = input;
+		this->recompute();
+		return this->output();
+	}
+
+	const std::vector<double>& IncrementalSession::update ( const sparse_vector& delta )
+	{
+		if ( !this->ready )
+			throw std::logic_error("IncrementalSession: evaluate an input before updating it");
+
+		for (auto it = delta.begin(); it != delta.end(); ++it)
+			if ( it->first < 0 || it->first >= (int)this->x.size() )
+				throw std::out_of_range("IncrementalSession: feature index out of range");
+
+		// the weights moved on, or the sums have had enough updates that they're due a refresh
+		if ( this->net.version() != this->version || ++this->updates >= this->refresh )
+		{
+			for (auto it = delta.begin(); it != delta.end(); ++it)
+				this->x[ it->first ] = it->second;
+
+			this->recompute();
+			return this->output();
+		}
+
+		// column j of the first layer holds the weight every neuron gives feature j
+		Network::Layer& first = *this->layers.front();
+		const double* columns = first.columns();
+		const int width = this->sums.size();
+		double* sums = this->sums.data();
+
+		for (auto it = delta.begin(); it != delta.end(); ++it)
+		{
+			const double d = it->second - this->x[ it->first ];
+			if ( d == 0 )
+				continue;
+
+			const double* column = columns + (size_t)it->first * width;
+			for (int i = 0; i < width; ++i)
+				sums[i] += d * column[i];
+
+			this->x[ it->first ] = it->second;
+		}
+
+		this->propagate();
+		return this->output();
+	}
+
+	const std::vector<double>& IncrementalSession::update ( int index, double value )
+	{
+		return this->update( sparse_vector( 1, std::make_pair( index, value ) ) );
+	}
+
+	const std::vector<double>& IncrementalSession::input () const
+	{
+		return this->x;
+	}
+
+	const std::vector<double>& IncrementalSession::output () const
+	{
+		return this->activations.back();
+	}
+
+	// a full pass: the first layer's sums in the same order as dot(), so the scores match feedForward exactly
+	void IncrementalSession::recompute ()
+	{
+		if ( this->net.version() != this->version )
+			this->reshape();
+
+		const Network::Layer& first = *this->layers.front();
+		const int width = this->sums.size();
+		const int cols = this->x.size();
+		const double* row = first.weights.data();
+
+		for (int i = 0; i < width; ++i, row += cols)
+			this->sums[i] = dot( this->x.data(), row, cols );
+
+		this->version = this->net.version();
+		this->updates = 0;
+		this->ready = true;
+		this->propagate();
+	}
+
+	// size the buffers to the layers as they are now; removing neurons shrinks a layer in place
+	void IncrementalSession::reshape ()
+	{
+		this->layers.clear();
+		for (auto it = this->net.begin(); it != this->net.end(); ++it)
+			this->layers.push_back( &*it );
+
+		this->activations.resize( this->layers.size() );
+		for (size_t l = 0; l < this->layers.size(); ++l)
+			this->activations[l].resize( this->layers[l]->size() );
+
+		this->sums.resize( this->layers.front()->size() );
+	}
+
+	// apply the activation function to the first layer's sums, and run the rest of the network
+	void IncrementalSession::propagate ()
+	{
+		const ActFunction& actf = this->net.activate(0);
+		std::vector<double>& first = this->activations.front();
+
+		for (size_t i = 0; i < this->sums.size(); ++i)
+			first[i] = actf.dxdy( this->sums[i] );
+
+		for (size_t l = 1; l < this->layers.size(); ++l)
+			this->layers[l]->forward( this->activations[l-1].data(), this->activations[l].data(), 1 );
+	}
+}
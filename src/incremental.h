@@ -0,0 +1,84 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <vector>
+
+#include "network.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Incremental Session
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * re-scores an input after a few of its features change, without redoing the first layer
+	 *
+	 * the session keeps the last input and the first layer's sums (before the activation function).
+	 * Changing feature j by d moves every sum by d times column j of the first layer's weights, so
+	 * an update costs O(changed features x first layer width) plus the layers after the first,
+	 * instead of a pass over the whole first weight block.
+	 *
+	 * the updated sums are added up in a different order than a full pass would use, so they drift
+	 * from it by a few ulps per update; every 'refresh' updates the session recomputes everything,
+	 * which bounds the drift. It also recomputes whenever the network's weights have changed, after
+	 * resizing its buffers to the layers (which removing neurons shrinks).
+	 *
+	 * a session isn't thread safe; use one per thread.
+	 *
+	 */
+	class IncrementalSession
+	{
+	public:
+
+		IncrementalSession ( Network&, int = 1024 );
+
+		// score a new input from scratch, and remember it for later updates
+		const std::vector<double>& evaluate ( const std::vector<double>& );
+
+		// change the features listed in 'delta' (index, new value) and re-score
+		const std::vector<double>& update ( const sparse_vector& );
+
+		// change a single feature and re-score
+		const std::vector<double>& update ( int, double );
+
+		// the current input, with every update applied
+		const std::vector<double>& input () const;
+
+		// the most recent scores
+		const std::vector<double>& output () const;
+
+	private:
+
+		void reshape ();
+		void recompute ();
+		void propagate ();
+
+		Network& net;
+		std::vector<Network::Layer*> layers;
+		int refresh;
+		int updates;
+		unsigned long long version;
+		bool ready;
+
+		std::vector<double> x;		// the current input
+		std::vector<double> sums;	// the first layer's sums for x
+		std::vector<std::vector<double> > activations;	// the output of each layer for x
+
+	}; // end class IncrementalSession
+}
+
+#endif
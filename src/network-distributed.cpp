@@ -0,0 +1,62 @@
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 								Distributed Training
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Implementations of the data-parallel training methods of the Network class defined in 'network.h'
+ *
+ * Each process of a group trains its own copy of the network on its own shard of the data. The
+ * copies start from the same weights, and every training step averages each layer's gradient over
+ * the group (see 'collective.h') before the update, so they take the same steps and stay the same.
+ *
+ * by jonbrennecke / https://github.com/jonbrennecke
+ *
+ */
+
+#include <vector>
+#include "network.h"
+#include "collective.h"
+
+namespace machine {
+
+	/**
+	 * train as one of a group of processes; every member of the group must call this, with a
+	 * network of the same shape
+	 *
+	 * the weights of the group's first member are copied to the others, so they all start from the
+	 * same place. A nullptr goes back to training alone.
+	 *
+	 * :param group - the processes training copies of this network
+	 */
+	void Network::distribute ( Communicator* group )
+	{
+		this->group = group;
+
+		if ( !group || group->size() < 2 )
+			return;
+
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+			group->broadcast( (*it)->weights.data(), (*it)->weights.size(), 0 );
+
+		this->weightsChanged();
+	}
+
+	Communicator* Network::communicator () const
+	{
+		return this->group;
+	}
+
+	// replace the layer's gradient with its average over the group
+	void Network::averageGradient ( Layer& layer )
+	{
+		if ( !this->group || this->group->size() < 2 )
+			return;
+
+		std::vector<double>& gradient = layer.gradient;
+		this->group->allreduce( gradient.data(), gradient.size() );
+
+		const double scale = 1.0 / this->group->size();
+		for (auto g = gradient.begin(); g != gradient.end(); ++g)
+			*g *= scale;
+	}
+}
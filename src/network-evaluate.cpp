@@ -0,0 +1,170 @@
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 								Dataset Evaluation
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Implementation of Network::evaluate, defined in 'network.h'
+ *
+ * The dataset is cut into batches, and the batches are shared out over the thread pool. Each
+ * thread runs its batches through the layers' batched kernels in buffers of its own, and scores
+ * them as it goes, so the outputs are never collected. The sums of each batch are kept apart and
+ * added up in order at the end, which gives the same result however the batches were shared out.
+ *
+ * The scores follow the kind of outputs: the logits of a softmaxOutput network are scored as the
+ * probabilities softmax gives them, against the softmax cross-entropy training minimizes, and
+ * squashed outputs are scored as they are, against the binary cross-entropy of each one.
+ *
+ * by jonbrennecke / https://github.com/jonbrennecke
+ *
+ */
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include "network.h"
+#include "classifier.h"
+#include "threadpool.h"
+
+namespace machine {
+
+	// the partial sums of one batch
+	struct BatchScore
+	{
+		double squared;
+		double entropy;
+		long correct;
+	};
+
+	/**
+	 * :param inputs / targets - the dataset
+	 * :param batch - number of samples per batch
+	 *
+	 * the network mustn't be trained while it's evaluated
+	 */
+	Network::Metrics Network::evaluate ( const std::vector<std::vector<double> >& inputs, const std::vector<std::vector<double> >& targets, int batch )
+	{
+		if ( inputs.size() != targets.size() )
+			throw std::invalid_argument("Network::evaluate: expected one target per input");
+
+		const int n = inputs.size();
+		const int width = this->inputs();
+		const int outputs = this->outputs();
+		const int classes = outputs > 1 ? outputs : 2;
+		const bool logits = this->softmaxOutput() && outputs > 1;
+
+		for (int s = 0; s < n; ++s)
+		{
+			if ( (int)inputs[s].size() != width )
+				throw std::invalid_argument("Network::evaluate: the input doesn't match the size of the input layer");
+			if ( (int)targets[s].size() != outputs )
+				throw std::invalid_argument("Network::evaluate: the target doesn't match the size of the output layer");
+		}
+
+		batch = std::max( batch, 1 );
+		const int batches = ( n + batch - 1 ) / batch;
+
+		size_t widest = width;
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+			widest = std::max( widest, (size_t)(*it)->nNeurons );
+
+		std::vector<BatchScore> scores( batches );
+		std::vector<long> confusion( classes * classes, 0 );
+		std::mutex merge;
+
+		auto start = std::chrono::steady_clock::now();
+
+		auto score = [&]( size_t lo, size_t hi ) {
+			std::vector<double> a( batch * widest ), b( batch * widest ), p( outputs );
+			std::vector<long> counts( classes * classes, 0 );
+
+			for (size_t c = lo; c < hi; ++c)
+			{
+				const int first = c * batch;
+				const int m = std::min( batch, n - first );
+
+				for (int s = 0; s < m; ++s)
+					std::copy( inputs[ first + s ].begin(), inputs[ first + s ].end(), a.begin() + s * width );
+
+				for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+				{
+					(*it)->forward( a.data(), b.data(), m );
+					a.swap(b);
+				}
+
+				BatchScore sums = { 0, 0, 0 };
+
+				for (int s = 0; s < m; ++s)
+				{
+					const double* out = a.data() + s * outputs;
+					const double* target = targets[ first + s ].data();
+
+					if ( logits )
+					{
+						// the cross-entropy against the target probabilities, and the error of softmax's
+						const double lse = logSumExp( out, outputs );
+						for (int i = 0; i < outputs; ++i)
+						{
+							p[i] = std::exp( out[i] - lse );
+							sums.entropy += target[i] * ( lse - out[i] );
+						}
+					}
+					else
+					{
+						for (int i = 0; i < outputs; ++i)
+						{
+							const double y = std::min( std::max( out[i], 1e-12 ), 1 - 1e-12 );
+							p[i] = out[i];
+							sums.entropy -= target[i] * std::log(y) + ( 1 - target[i] ) * std::log( 1 - y );
+						}
+					}
+
+					for (int i = 0; i < outputs; ++i)
+						sums.squared += ( p[i] - target[i] ) * ( p[i] - target[i] );
+
+					const int actual = outputs > 1 ? argmax( target, outputs ) : target[0] > 0.5;
+					const int predicted = outputs > 1 ? argmax( out, outputs ) : out[0] > 0.5;
+
+					sums.correct += actual == predicted;
+					++counts[ actual * classes + predicted ];
+				}
+
+				scores[c] = sums;
+			}
+
+			std::lock_guard<std::mutex> lock( merge );
+			for (size_t i = 0; i < counts.size(); ++i)
+				confusion[i] += counts[i];
+		};
+
+		ThreadPool::global().parallelFor( 0, batches, 1, std::cref(score) );
+
+		Metrics metrics;
+		metrics.samples = n;
+		metrics.mse = metrics.crossEntropy = metrics.accuracy = 0;
+
+		long correct = 0;
+		for (auto it = scores.begin(); it != scores.end(); ++it)
+		{
+			metrics.mse += it->squared;
+			metrics.crossEntropy += it->entropy;
+			correct += it->correct;
+		}
+
+		if ( n > 0 )
+		{
+			metrics.mse /= (double)n * outputs;
+			metrics.crossEntropy /= n;
+			metrics.accuracy = (double)correct / n;
+		}
+
+		metrics.confusion.assign( classes, std::vector<long>( classes ) );
+		for (int t = 0; t < classes; ++t)
+			std::copy( confusion.begin() + t * classes, confusion.begin() + ( t + 1 ) * classes, metrics.confusion[t].begin() );
+
+		metrics.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+		return metrics;
+	}
+}
@@ -0,0 +1,170 @@
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 								Source Export
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Writes a trained Network out as a self-contained C++ header, for services that want the
+ * network compiled in rather than linking this library and loading weights at startup.
+ *
+ * The header has no dependencies besides <cmath>. Every weight is an 'alignas(64) static const'
+ * array written with 17 significant digits, so the values round-trip exactly, and the forward
+ * function sums every neuron in the same order as dot(), so its output is bit-for-bit the output
+ * of Network::feedForward as long as the compiler keeps every multiply and add apart.
+ * -ffast-math lets it reorder the sums, and -ffp-contract=fast fuses them into FMA instructions,
+ * which GCC does by default in its GNU dialects (-std=gnu++11, the default) on any target with FMA;
+ * so a service built with -march=native gets outputs that differ in the last few bits, and should
+ * compare them to a tolerance (or build with -ffp-contract=off).
+ *
+ * by jonbrennecke / https://github.com/jonbrennecke
+ *
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include "network.h"
+
+namespace machine {
+
+	// the expression generated for each built in activation function, in terms of 'x';
+	// these have to stay the same as the definitions in 'network-fun.cpp'
+	static std::string activationSource ( const ActFunction& actf )
+	{
+		if ( actf.name == "sigmoid" )
+			return "1 / ( 1 + std::exp(-x) )";
+		if ( actf.name == "softplus" )
+			return "std::log10( 1 + std::exp(x) )";
+		if ( actf.name == "hyperbolic_tan" )
+			return "std::tanh(x)";
+
+		throw std::invalid_argument("Network::exportHeader: only the built in activation functions can be exported");
+	}
+
+	static bool isIdentifier ( const std::string& name )
+	{
+		if ( name.empty() || std::isdigit( (unsigned char)name[0] ) )
+			return false;
+
+		for (auto it = name.begin(); it != name.end(); ++it)
+			if ( !std::isalnum( (unsigned char)*it ) && *it != '_' )
+				return false;
+
+		return true;
+	}
+
+	// 17 significant digits are always enough for the compiler to read back the exact same double
+	// (hexadecimal float literals would be shorter, but they need C++17)
+	static std::string literal ( double x )
+	{
+		if ( !std::isfinite(x) )
+			throw std::domain_error("Network::exportHeader: can't export a weight that isn't finite");
+
+		char buffer[32];
+		std::snprintf( buffer, sizeof(buffer), "%.17g", x );
+		return buffer;
+	}
+
+	void Network::exportHeader ( std::string file, std::string name )
+	{
+		std::ofstream out( file );
+		if ( !out )
+			throw std::runtime_error("Network::exportHeader: couldn't open " + file);
+
+		this->exportHeader( out, name );
+	}
+
+	/**
+	 * write the network as a header defining, in namespace 'name':
+	 *
+	 * 		static const int inputs, outputs;
+	 * 		static inline void forward ( const double* input, double* output );
+	 *
+	 * (for a network with softmax outputs, 'forward' writes the logits, as Network::feedForward does)
+	 *
+	 * the loops all have constant bounds, so the compiler can unroll them as far as it likes;
+	 * nothing is allocated, and the activations of the hidden layers live on the stack
+	 *
+	 * :param os - stream to write the header to
+	 * :param name - namespace of the generated code, which also names the include guard
+	 */
+	void Network::exportHeader ( std::ostream& os, std::string name )
+	{
+		if ( !isIdentifier(name) )
+			throw std::invalid_argument("Network::exportHeader: '" + name + "' isn't a valid C++ identifier");
+
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+			if ( (*it)->kernel == Layer::Generic )
+				throw std::invalid_argument("Network::exportHeader: only networks using the dot product propogation function can be exported");
+
+		const std::string activation = activationSource( this->activate() );
+		const bool linearOutput = this->softmaxOutput();
+
+		std::string guard(name);
+		std::transform( guard.begin(), guard.end(), guard.begin(), ::toupper );
+		guard += "_NETWORK_H";
+
+		// the hidden layers write to two scratch buffers in turn, 'a' for the even layers and 'b' for the odd
+		// ones; each is as wide as the widest layer writing to it, and isn't declared if no layer does
+		int widest[2] = { 0, 0 };
+		for (size_t l = 0; l + 1 < this->layers.size(); ++l)
+			widest[ l % 2 ] = std::max( widest[ l % 2 ], this->layers[l]->nNeurons );
+
+		os << "// generated by machine::Network::exportHeader, from version " << this->version() << " of the weights\n"
+		   << "#ifndef " << guard << "\n"
+		   << "#define " << guard << "\n\n"
+		   << "#include <cmath>\n\n"
+		   << "namespace " << name << " {\n\n"
+		   << "\tstatic const int inputs = " << this->inputs() << ";\n"
+		   << "\tstatic const int outputs = " << this->outputs() << ";\n\n";
+
+		for (size_t l = 0; l < this->layers.size(); ++l)
+		{
+			const Layer& layer = *this->layers[l];
+
+			os << "\t// layer " << l << ": " << layer.nNeurons << " x " << layer.nWeights << ", row-major\n"
+			   << "\talignas(64) static const double layer" << l << "[" << layer.weights.size() << "] = {";
+
+			for (size_t i = 0; i < layer.weights.size(); ++i)
+				os << ( i % 4 ? " " : "\n\t\t" ) << literal( layer.weights[i] ) << ",";
+
+			os << "\n\t};\n\n";
+		}
+
+		os << "\tstatic inline double activate ( double x )\n"
+		   << "\t{\n"
+		   << "\t\treturn " << activation << ";\n"
+		   << "\t}\n\n"
+		   << "\tstatic inline void forward ( const double* input, double* output )\n"
+		   << "\t{\n";
+
+		if ( widest[0] > 0 )
+			os << "\t\tdouble a[" << widest[0] << "];\n";
+		if ( widest[1] > 0 )
+			os << "\t\tdouble b[" << widest[1] << "];\n";
+
+		for (size_t l = 0; l < this->layers.size(); ++l)
+		{
+			const Layer& layer = *this->layers[l];
+			const bool last = l + 1 == this->layers.size();
+			const std::string in = l == 0 ? "input" : ( l % 2 ? "a" : "b" );
+			const std::string out = last ? "output" : ( l % 2 ? "b" : "a" );
+
+			os << "\n\t\tfor (int i = 0; i < " << layer.nNeurons << "; ++i)\n"
+			   << "\t\t{\n"
+			   << "\t\t\tconst double* row = layer" << l << " + i * " << layer.nWeights << ";\n"
+			   << "\t\t\tdouble sum = 0;\n"
+			   << "\t\t\tfor (int j = 0; j < " << layer.nWeights << "; ++j)\n"
+			   << "\t\t\t\tsum += " << in << "[j] * row[j];\n"
+			   << "\t\t\t" << out << "[i] = " << ( last && linearOutput ? "sum" : "activate(sum)" ) << ";\n"
+			   << "\t\t}\n";
+		}
+
+		os << "\t}\n"
+		   << "}\n\n"
+		   << "#endif\n";
+	}
+}
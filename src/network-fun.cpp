@@ -19,8 +19,11 @@
 #include <cmath>
 #include <random>
 #include <stdexcept>
+#include <algorithm>
 
 #include "network.h"
+#include "classifier.h"
+#include "trace.h"
 
 namespace machine {
 
@@ -37,7 +40,8 @@ namespace machine {
 		}), 
 		activationFunctionFactory([]( double y ) {
 			return y * (1 - y);
-		})
+		}),
+		"sigmoid"
 	};
 
 	// see http://en.wikipedia.org/wiki/Sigmoid_function
@@ -45,9 +49,11 @@ namespace machine {
 		activationFunctionFactory([]( double x ) {
 			return log10( 1 + exp(x) );
 		}), 
+		// dy/dx = sigmoid(x) / ln(10), and since 1 + exp(x) = 10^y, sigmoid(x) = 1 - 10^-y
 		activationFunctionFactory([]( double y ) {
-			return 1 / (1 + exp(-y));
-		})
+			return ( 1 - pow(10, -y) ) / log(10.0);
+		}),
+		"softplus"
 	};
 
 	// see http://en.wikipedia.org/wiki/Hyperbolic_tangent
@@ -55,10 +61,21 @@ namespace machine {
 		activationFunctionFactory([]( double x ) {
 			return tanh(x);
 		}), 
-		// d(tanh)/dy = sech^2(y)
+		// d(tanh)/dx = sech^2(x) = 1 - tanh^2(x)
 		activationFunctionFactory([]( double y ) {
-			return pow( (2 * exp(-y)) / ( 1 + exp(-2 * y)), 2);
-		})
+			return 1 - y * y;
+		}),
+		"hyperbolic_tan"
+	};
+
+	ActFunction identity {
+		activationFunctionFactory([]( double x ) {
+			return x;
+		}),
+		activationFunctionFactory([]( double ) {
+			return 1.0;
+		}),
+		"identity"
 	};
 
 	/**
@@ -71,7 +88,87 @@ namespace machine {
 	std::random_device rd;
 	std::default_random_engine rng( rd() );
 	std::uniform_real_distribution<double> dist(0,1);
-	auto random = initFunctionFactory( std::bind( dist, rng ) );
+	init_handle random = initFunctionFactory( std::bind( dist, rng ) );
+
+	init_scale uniform = []( double u, int, int ) {
+		return u;
+	};
+
+	init_scale xavier = []( double u, int fanIn, int fanOut ) {
+		return ( 2 * u - 1 ) * std::sqrt( 6.0 / ( fanIn + fanOut ) );
+	};
+
+	init_scale he = []( double u, int fanIn, int ) {
+		return ( 2 * u - 1 ) * std::sqrt( 6.0 / fanIn );
+	};
+
+	/**
+	 * the generator is Philox4x32-10, see Salmon et al. "Parallel Random Numbers: As Easy as 1, 2, 3" (SC11):
+	 * a bijection of a 128 bit counter under a 64 bit key, so distinct counters give independent random
+	 * numbers and there's no generator state to share between threads
+	 *
+	 * one block of the generator gives 128 random bits, which make two doubles with 53 random bits each;
+	 * the counter is (column pair, row, layer, 0) and the key is the seed, so weight (row, col) of a
+	 * layer is the same no matter which thread computes it, or in what order
+	 *
+	 * the lanes are kept in separate arrays of 8 so the 32 x 32 -> 64 bit multiplies of neighbouring
+	 * column pairs can be done together in vector registers
+	 */
+	void initializeBlock ( double* weights, int rows, int cols, int lo, int hi, int layer, uint64_t seed, init_scale scale )
+	{
+		static const int lanes = 8;
+		const uint32_t key[2] = { (uint32_t)seed, (uint32_t)( seed >> 32 ) };
+		const int pairs = ( cols + 1 ) / 2;
+
+		for (int i = lo; i < hi; ++i)
+		{
+			double* row = weights + (size_t)i * cols;
+
+			for (int p = 0; p < pairs; p += lanes)
+			{
+				uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+
+				for (int l = 0; l < lanes; ++l)
+				{
+					c0[l] = p + l;
+					c1[l] = i;
+					c2[l] = layer;
+					c3[l] = 0;
+				}
+
+				uint32_t k0 = key[0], k1 = key[1];
+				for (int round = 0; round < 10; ++round)
+				{
+					for (int l = 0; l < lanes; ++l)
+					{
+						const uint64_t p0 = (uint64_t)0xD2511F53 * c0[l];
+						const uint64_t p1 = (uint64_t)0xCD9E8D57 * c2[l];
+
+						const uint32_t n0 = (uint32_t)( p1 >> 32 ) ^ c1[l] ^ k0;
+						const uint32_t n2 = (uint32_t)( p0 >> 32 ) ^ c3[l] ^ k1;
+						c1[l] = (uint32_t)p1;
+						c3[l] = (uint32_t)p0;
+						c0[l] = n0;
+						c2[l] = n2;
+					}
+
+					k0 += 0x9E3779B9;
+					k1 += 0xBB67AE85;
+				}
+
+				for (int l = 0; l < lanes && p + l < pairs; ++l)
+				{
+					const int j = 2 * ( p + l );
+					const double u0 = ( ( c0[l] >> 5 ) * 67108864.0 + ( c1[l] >> 6 ) ) / 9007199254740992.0;
+					const double u1 = ( ( c2[l] >> 5 ) * 67108864.0 + ( c3[l] >> 6 ) ) / 9007199254740992.0;
+
+					row[j] = scale( u0, cols, rows );
+					if ( j + 1 < cols )
+						row[j + 1] = scale( u1, cols, rows );
+				}
+			}
+		}
+	}
 
 	/**
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -93,7 +190,18 @@ namespace machine {
 		return c;
 	}
 
-	auto dotprod = propFunctionFactory( __dotprod );
+	prop_handle dotprod = propFunctionFactory( __dotprod );
+
+	// the same dot product on raw arrays, summed in the same order as __dotprod
+	double dot ( const double* a, const double* b, size_t n )
+	{
+		double c = 0;
+
+		for (size_t i = 0; i < n; ++i)
+			c += a[i] * b[i];
+
+		return c;
+	}
 
 	/**
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -101,58 +209,405 @@ namespace machine {
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	 */
 
+	/**
+	 * 
+	 * ~~~~~ Optimizers ~~~~~
+	 * 
+	 * update rules applied to a layer's weight block once its gradient has been computed
+	 *
+	 * each rule is a single fused pass over the weights, the gradient and the optimizer's state,
+	 * which are all contiguous arrays of the same length, so the loops touch each cache line once
+	 * and are simple enough for the compiler to vectorize. The pass is split with Layer::forWeights,
+	 * so on a NUMA placed layer each node updates the weights that live in its own memory.
+	 *
+	 * see http://sebastianruder.com/optimizing-gradient-descent/
+	 */
+	typedef void (*update_rule)( Network::Layer&, const Network& );
+
+	// plain gradient descent: w -= rate * g
+	void _sgd ( Network::Layer& layer, const Network& net )
+	{
+		double* w = layer.weights.data();
+		const double* g = layer.gradient.data();
+		const double rate = net.rate();
+
+		layer.forWeights( [&]( size_t lo, size_t hi ) {
+			for (size_t i = lo; i < hi; ++i)
+				w[i] -= rate * g[i];
+		});
+	}
+
+	// classical momentum: v = mu * v - rate * g; w += v
+	void _momentum ( Network::Layer& layer, const Network& net )
+	{
+		const size_t n = layer.weights.size();
+		layer.moment1.resize(n, 0);
+
+		double* w = layer.weights.data();
+		double* v = layer.moment1.data();
+		const double* g = layer.gradient.data();
+		const double rate = net.rate();
+		const double mu = net.momentum();
+
+		layer.forWeights( [&]( size_t lo, size_t hi ) {
+			for (size_t i = lo; i < hi; ++i)
+			{
+				v[i] = mu * v[i] - rate * g[i];
+				w[i] += v[i];
+			}
+		});
+	}
+
+	// Nesterov momentum, in the form that only needs the gradient at the current weights:
+	// v' = mu * v - rate * g; w += -mu * v + (1 + mu) * v'
+	void _nesterov ( Network::Layer& layer, const Network& net )
+	{
+		const size_t n = layer.weights.size();
+		layer.moment1.resize(n, 0);
+
+		double* w = layer.weights.data();
+		double* v = layer.moment1.data();
+		const double* g = layer.gradient.data();
+		const double rate = net.rate();
+		const double mu = net.momentum();
+
+		layer.forWeights( [&]( size_t lo, size_t hi ) {
+			for (size_t i = lo; i < hi; ++i)
+			{
+				double prev = v[i];
+				v[i] = mu * v[i] - rate * g[i];
+				w[i] += -mu * prev + ( 1 + mu ) * v[i];
+			}
+		});
+	}
+
+	// RMSProp: s = rho * s + (1 - rho) * g^2; w -= rate * g / (sqrt(s) + eps)
+	void _rmsprop ( Network::Layer& layer, const Network& net )
+	{
+		const size_t n = layer.weights.size();
+		layer.moment2.resize(n, 0);
+
+		double* w = layer.weights.data();
+		double* s = layer.moment2.data();
+		const double* g = layer.gradient.data();
+		const double rate = net.rate();
+		const double rho = net.decay();
+		const double eps = net.epsilon();
+
+		layer.forWeights( [&]( size_t lo, size_t hi ) {
+			for (size_t i = lo; i < hi; ++i)
+			{
+				s[i] = rho * s[i] + ( 1 - rho ) * g[i] * g[i];
+				w[i] -= rate * g[i] / ( std::sqrt(s[i]) + eps );
+			}
+		});
+	}
+
+	// Adam, with the bias corrections folded into the step size
+	// see http://arxiv.org/abs/1412.6980
+	void _adam ( Network::Layer& layer, const Network& net )
+	{
+		const size_t n = layer.weights.size();
+		layer.moment1.resize(n, 0);
+		layer.moment2.resize(n, 0);
+
+		double* w = layer.weights.data();
+		double* m = layer.moment1.data();
+		double* v = layer.moment2.data();
+		const double* g = layer.gradient.data();
+		const double beta1 = net.momentum();
+		const double beta2 = net.decay();
+		const double eps = net.epsilon();
+
+		double t = (double)( ++layer.updates );
+		const double step = net.rate() * std::sqrt( 1 - std::pow(beta2, t) ) / ( 1 - std::pow(beta1, t) );
+		const double epshat = eps * std::sqrt( 1 - std::pow(beta2, t) );
+
+		layer.forWeights( [&]( size_t lo, size_t hi ) {
+			for (size_t i = lo; i < hi; ++i)
+			{
+				m[i] = beta1 * m[i] + ( 1 - beta1 ) * g[i];
+				v[i] = beta2 * v[i] + ( 1 - beta2 ) * g[i] * g[i];
+				w[i] -= step * m[i] / ( std::sqrt(v[i]) + epshat );
+			}
+		});
+	}
+
 	/**
 	 * 
 	 * ~~~~~ Back Propogation ~~~~~
 	 * 
 	 * Train the network by 'back propogation'
 	 * see http://en.wikipedia.org/wiki/Backpropagation
+	 *
+	 * one forward pass records the input and output of every layer; the backward pass then
+	 * works down from the output layer using only those cached activations. For each layer,
+	 *
+	 * 		delta = dE/d(output) * f'(output)
+	 * 		gradient[i][j] = delta[i] * input[j]
+	 * 		dE/d(input) = W^T * delta
+	 *
+	 * where E is the squared error of the output layer (or, for a network with softmax outputs, the
+	 * softmax cross-entropy, see 'outputError'), and dE/d(input) of a layer is dE/d(output) of the
+	 * layer below it. The error is propogated through the weights before they're updated.
+	 *
+	 * 'input' and 'expected' may hold a mini-batch of several samples stored one after another,
+	 * in which case the gradient is averaged over the batch and the weights are updated once.
+	 * The activations and the errors all live in the network's preallocated arena, so after the
+	 * first step of a given batch size no memory is allocated.
+	 *
+	 * when the network is distributed, each layer's gradient is averaged over the group before the
+	 * update, so every process takes the same step, for the combined batch of all of them.
+	 *
+	 * :return - the output of the network (for every sample) before the update
+	 */
+	static std::vector<double> _mixedBackPropogation ( std::vector<double>, std::vector<double>, Network&, update_rule );
+
+	/**
+	 * dE/d(output) of the output layer for 'batch' samples of n outputs, times 'scale': output - expected
+	 * for the squared error, or softmax(output) - expected for the softmax cross-entropy (the gradient
+	 * of the classifier's kernel, see 'classifier.cpp'). A softmax output layer has no activation
+	 * function, so the latter is already the delta of its sums.
 	 */
-	std::vector<double> _backPropogation ( std::vector<double> input, std::vector<double> expected, Network& net )
+	static void outputError ( const double* output, const double* expected, size_t n, int batch, bool softmax, double scale, double* error )
 	{
+		for (int b = 0; b < batch; ++b, output += n, expected += n, error += n)
+		{
+			if ( softmax )
+				softmaxCrossEntropy( output, n, expected, error );
+			else
+				for (size_t i = 0; i < n; ++i)
+					error[i] = output[i] - expected[i];
+
+			for (size_t i = 0; i < n; ++i)
+				error[i] *= scale;
+		}
+	}
+
+	// the same in float32, for mixed precision; a softmax's outputs are widened into 'staging' (n doubles) first
+	static void outputError ( const float* output, const double* expected, size_t n, int batch, bool softmax, float scale, float* error, double* staging )
+	{
+		for (int b = 0; b < batch; ++b, output += n, expected += n, error += n)
+		{
+			if ( !softmax )
+			{
+				for (size_t i = 0; i < n; ++i)
+					error[i] = ( output[i] - (float)expected[i] ) * scale;
+				continue;
+			}
+
+			std::copy( output, output + n, staging );
+			softmaxCrossEntropy( staging, n, expected, staging );
+			for (size_t i = 0; i < n; ++i)
+				error[i] = (float)staging[i] * scale;
+		}
+	}
+
+	std::vector<double> _backPropogation ( std::vector<double> input, std::vector<double> expected, Network& net, update_rule update )
+	{
+		const int batch = input.size() / net.inputs();
+
+		if ( batch == 0 || input.size() != (size_t)( batch * net.inputs() ) )
+			throw std::invalid_argument("backPropogation: the input isn't a whole number of input vectors");
+		if ( expected.size() != (size_t)( batch * net.outputs() ) )
+			throw std::invalid_argument("backPropogation: the expected vector doesn't match the size of the output layer");
+
+		if ( net.mixedPrecision() )
+			return _mixedBackPropogation( std::move(input), std::move(expected), net, update );
+
 		// get the result of feeding the input into the network
-		std::vector<double> output = net.feedForward(input);
+		net.forward( input.data(), batch );
 
-		ActFunction actf = net.activate();
-		double rate = net.rate();
+		const double scale = 1.0 / batch;
+
+		// dE/d(output) of the output layer, averaged over the batch
+		double* error = net.errorBuffer(0);
+		double* below = net.errorBuffer(1);
+		const double* output = net.rbegin()[0]->getOutput().begin();
+		outputError( output, expected.data(), net.outputs(), batch, net.softmaxOutput(), scale, error );
 
 		// ~~~~~ loop backwards over the layers ~~~~~
-		// 
-		// as we descend though the layers, the difference between the output and the expected 
-		// result is propogated through each layer; while the change in weights (deltas) is computed 
-		// on for each layer.
 		for(auto layer = net.rbegin(); layer != net.rend(); ++layer)
 		{
+			// input and output of the layer, as recorded by the forward pass (or recomputed, between checkpoints)
+			net.restore( (*layer)->index );
+			TraceSpan span( "backward", "layer", (*layer)->index );
+			const size_t rows = (*layer)->getOutput().size();
+			const size_t cols = (*layer)->getInput().size();
+			const double* layer_input = (*layer)->getInput().begin();
+			const double* layer_output = (*layer)->getOutput().begin();
+			const ActFunction& actf = net.activate( (*layer)->index );
 
-			// input and output for each layer
-			std::vector<double> layer_input = (*layer)->getInput();
-			std::vector<double> layer_output = (*layer)->getOutput();
+			// the error becomes delta in place
+			for (size_t i = 0; i < rows * batch; ++i)
+				error[i] *= actf.dydx( layer_output[i] );
 
-			// iterate over the neurons in a vector
-			auto out = layer_output.begin();
-			for (auto neuron = (*layer)->begin(); neuron != (*layer)->end(); ++neuron, ++out)
-			{
+			// gradient of the weights: the sum over the batch of the outer product of delta and the layer's input
+			(*layer)->gradient.resize( rows * cols );
+			(*layer)->forRows( [&]( int lo, int hi ) {
+				for (size_t i = lo; i < (size_t)hi; ++i)
+				{
+					double* grad = (*layer)->gradient.data() + i * cols;
+					std::fill( grad, grad + cols, 0.0 );
+
+					for (int b = 0; b < batch; ++b)
+					{
+						const double d = error[ b * rows + i ];
+						const double* in = layer_input + b * cols;
+						for (size_t j = 0; j < cols; ++j)
+							grad[j] += d * in[j];
+					}
+				}
+			});
 
-				// the output layer is handled a bit differently, as it can be compared directly with the 
-				// expected answer
-				auto ex = expected.begin();
-				auto in = layer_input.begin();
-				for (auto weight = (*neuron).begin(); weight != (*neuron).end(); ++weight, ++in, ++ex )
+			// propogate the error through the transposed weights, accumulating one row at a time
+			// so that the weight block is read in the order it's stored
+			if ( layer + 1 != net.rend() )
+			{
+				std::fill( below, below + cols * batch, 0.0 );
+				for (int b = 0; b < batch; ++b)
 				{
-					// calculate the deltas of the weights
-					double delta = rate * ((*ex) - (*in)) * actf.dydx((*out)) * (*in);
-					(*weight) -= delta; 
+					const double* delta = error + b * rows;
+					const double* row = (*layer)->data();
+					double* out = below + b * cols;
 
+					for (size_t i = 0; i < rows; ++i, row += cols)
+					{
+						const double d = delta[i];
+						for (size_t j = 0; j < cols; ++j)
+							out[j] += row[j] * d;
+					}
 				}
+				std::swap( error, below );
 			}
+			span.end();
+
+			net.averageGradient( **layer );
+
+			TraceSpan step( "update", "layer", (*layer)->index );
+			update( **layer, net );
+		}
+
+		// hand the outputs back in the storage of 'expected', which is already the right size
+		std::copy( output, output + expected.size(), expected.begin() );
+		return expected;
+	}
+
+	using namespace std::placeholders;
+
+	/**
+	 * 
+	 * ~~~~~ Mixed Precision Back Propogation ~~~~~
+	 * 
+	 * the same algorithm as _backPropogation, with the activations, the errors and the copies of the
+	 * weights they're multiplied by all in float32. Each gradient is accumulated in double and handed
+	 * to the optimizer, which updates the double master weights; the float32 copies are refreshed from
+	 * those before the next step.
+	 *
+	 * the output error is multiplied by the network's loss scale, so that small errors deep in the
+	 * network don't flush to zero in float32, and the gradients are divided by it again. Because of
+	 * that the updates are held back until every gradient is known to be finite; a step that
+	 * overflowed is skipped and the scale is lowered (see Network::scaleLoss).
+	 */
+	static std::vector<double> _mixedBackPropogation ( std::vector<double> input, std::vector<double> expected, Network& net, update_rule update )
+	{
+		const int batch = input.size() / net.inputs();
+
+		for (auto layer = net.begin(); layer != net.end(); ++layer)
+			if ( layer->kernel == Network::Layer::Generic )
+				throw std::invalid_argument("backPropogation: mixed precision needs the dot product propogation function");
+
+		net.forward( input.data(), batch );
+
+		const double lossScale = net.lossScale();
+		const float scale = (float)( lossScale / batch );
+
+		// the double error buffers are only used as scratch here; their float32 twins hold the errors
+		float* error = net.shadow( net.errorBuffer(0) );
+		float* below = net.shadow( net.errorBuffer(1) );
+		const float* output = net.shadow( net.rbegin()[0]->getOutput().begin() );
+		outputError( output, expected.data(), net.outputs(), batch, net.softmaxOutput(), scale, error, net.errorBuffer(0) );
+
+		bool finite = true;
+
+		for (auto layer = net.rbegin(); layer != net.rend(); ++layer)
+		{
+			net.restore( (*layer)->index );
+			TraceSpan span( "backward", "layer", (*layer)->index );
 
-			// propogate the expected value down the chain by 
-			// recalculating the layer's output with the new weights
-			expected = (*layer)->feedForward( layer_input );
+			const size_t rows = (*layer)->getOutput().size();
+			const size_t cols = (*layer)->getInput().size();
+			const float* layer_input = net.shadow( (*layer)->getInput().begin() );
+			const float* layer_output = net.shadow( (*layer)->getOutput().begin() );
+			const ActFunction& actf = net.activate( (*layer)->index );
+
+			for (size_t i = 0; i < rows * batch; ++i)
+				error[i] *= (float)actf.dydx( layer_output[i] );
+
+			// float32 products, summed over the batch in double
+			(*layer)->gradient.resize( rows * cols );
+			(*layer)->forRows( [&]( int lo, int hi ) {
+				for (size_t i = lo; i < (size_t)hi; ++i)
+				{
+					double* grad = (*layer)->gradient.data() + i * cols;
+					std::fill( grad, grad + cols, 0.0 );
+
+					for (int b = 0; b < batch; ++b)
+					{
+						const float d = error[ b * rows + i ];
+						const float* in = layer_input + b * cols;
+						for (size_t j = 0; j < cols; ++j)
+							grad[j] += d * in[j];
+					}
+				}
+			});
+
+			// take the loss scale back out, and look out for overflow (in any of the group's gradients)
+			for (auto g = (*layer)->gradient.begin(); g != (*layer)->gradient.end(); ++g)
+				*g /= lossScale;
+
+			net.averageGradient( **layer );
+
+			double sum = 0;
+			for (auto g = (*layer)->gradient.begin(); g != (*layer)->gradient.end(); ++g)
+				sum += *g;
+			finite = finite && std::isfinite(sum);
+
+			if ( layer + 1 != net.rend() )
+			{
+				std::fill( below, below + cols * batch, 0.0f );
+				for (int b = 0; b < batch; ++b)
+				{
+					const float* delta = error + b * rows;
+					const float* row = (*layer)->floats();
+					float* out = below + b * cols;
+
+					for (size_t i = 0; i < rows; ++i, row += cols)
+					{
+						const float d = delta[i];
+						for (size_t j = 0; j < cols; ++j)
+							out[j] += row[j] * d;
+					}
+				}
+				std::swap( error, below );
+			}
 		}
 
+		if ( net.scaleLoss( !finite ) )
+			for (auto layer = net.rbegin(); layer != net.rend(); ++layer)
+			{
+				TraceSpan step( "update", "layer", (*layer)->index );
+				update( **layer, net );
+			}
+
+		// hand the outputs back in the storage of 'expected', as _backPropogation does
+		std::copy( output, output + expected.size(), expected.begin() );
 		return expected;
 	}
 
-	auto backPropogation = trainingFunctionFactory( _backPropogation );
+	train_handle backPropogation = trainingFunctionFactory( std::bind( _backPropogation, _1, _2, _3, _sgd ) );
+	train_handle momentum = trainingFunctionFactory( std::bind( _backPropogation, _1, _2, _3, _momentum ) );
+	train_handle nesterov = trainingFunctionFactory( std::bind( _backPropogation, _1, _2, _3, _nesterov ) );
+	train_handle rmsprop = trainingFunctionFactory( std::bind( _backPropogation, _1, _2, _3, _rmsprop ) );
+	train_handle adam = trainingFunctionFactory( std::bind( _backPropogation, _1, _2, _3, _adam ) );
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 								Memory Accounting
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Implementations of the memory accounting methods of the Network class defined in 'network.h'
+ *
+ * 'memory' counts what the network has actually allocated (by capacity, not size), and
+ * 'estimate' works out what a network built from a Parameters object would allocate, using the
+ * same topology and arena layout as the constructor, without building it.
+ *
+ * by jonbrennecke / https://github.com/jonbrennecke
+ *
+ */
+
+#include <vector>
+#include <algorithm>
+#include "network.h"
+#include "cache.h"
+
+namespace machine {
+
+	template <class T>
+	static size_t bytes ( const std::vector<T>& v )
+	{
+		return v.capacity() * sizeof(T);
+	}
+
+	// add the layers up into the network's totals
+	static void addLayers ( Network::MemoryUsage& usage )
+	{
+		for (auto it = usage.layers.begin(); it != usage.layers.end(); ++it)
+		{
+			it->total = it->weights + it->gradient + it->optimizer + it->copies + it->activations;
+			usage.weights += it->weights;
+			usage.gradient += it->gradient;
+			usage.optimizer += it->optimizer;
+			usage.copies += it->copies;
+			usage.activations += it->activations;
+		}
+	}
+
+	Network::MemoryUsage Network::memory () const
+	{
+		MemoryUsage usage = MemoryUsage();
+		const int depth = this->layers.size();
+		const size_t arenaBytes = bytes( this->arena ) + bytes( this->arena32 );
+		const size_t perDouble = this->arena32.empty() ? sizeof(double) : sizeof(double) + sizeof(float);
+
+		// the network's input slab
+		usage.activations = (size_t)this->arenaBatch * this->inputs() * perDouble;
+
+		for (int i = 0; i < depth; ++i)
+		{
+			const Layer& layer = *this->layers[i];
+			LayerMemory m = LayerMemory();
+
+			m.layer = layer.index;
+			m.weights = bytes( layer.weights );
+			m.gradient = bytes( layer.gradient );
+			m.optimizer = bytes( layer.moment1 ) + bytes( layer.moment2 );
+			m.copies = bytes( layer.sparseRows ) + bytes( layer.sparseColumns ) + bytes( layer.sparseValues ) + bytes( layer.transposed ) + bytes( layer.weights32 );
+
+			for (auto it = layer.replicas.begin(); it != layer.replicas.end(); ++it)
+				m.copies += it->size() * sizeof(double);
+
+			if ( isCheckpoint( i, this->checkpointEvery, depth ) )
+				m.activations = (size_t)this->arenaBatch * layer.nNeurons * perDouble;
+
+			usage.layers.push_back(m);
+		}
+
+		addLayers( usage );
+		usage.activations = std::min( usage.activations, arenaBytes );
+		usage.scratch = arenaBytes - usage.activations;
+
+		if ( this->resultCache )
+			usage.cache = this->resultCache->stats().bytes;
+
+		usage.total = usage.weights + usage.gradient + usage.optimizer + usage.copies + usage.activations + usage.scratch + usage.cache;
+		return usage;
+	}
+
+	/**
+	 * what a network built from 'params' would hold after training on batches of 'batch' samples
+	 * (by default, the batch size in 'params')
+	 *
+	 * the gradient is counted for every layer, since the built in training functions all keep one;
+	 * the optimizer state is one moment per weight for 'momentum', 'nesterov' and 'rmsprop', and two
+	 * for 'adam'. Copies that are only made on demand (the transposed copy for feedForwardSparse, and
+	 * the sparse copies after pruning) aren't counted, nor are the per-node copies, which depend on the
+	 * machine; the cache is counted at its capacity.
+	 */
+	Network::MemoryUsage Network::estimate ( const Parameters& params, int batch )
+	{
+		if ( batch <= 0 )
+			batch = std::max( (int)params.__batchSize, 1 );
+
+		const std::vector<std::pair<int, int> > shapes = topology( params );
+		const int depth = shapes.size();
+		const int inputs = depth > 0 ? shapes.front().second : 0;
+
+		std::vector<int> widths;
+		for (auto it = shapes.begin(); it != shapes.end(); ++it)
+			widths.push_back( it->first );
+
+		int moments = 0;
+		if ( params.trainf == machine::momentum || params.trainf == machine::nesterov || params.trainf == machine::rmsprop )
+			moments = 1;
+		else if ( params.trainf == machine::adam )
+			moments = 2;
+
+		const int k = checkpointInterval( widths, inputs, batch, params );
+		const size_t perDouble = params.__mixedPrecision ? sizeof(double) + sizeof(float) : sizeof(double);
+
+		MemoryUsage usage = MemoryUsage();
+		usage.activations = (size_t)batch * inputs * perDouble;
+
+		for (int i = 0; i < depth; ++i)
+		{
+			const size_t n = (size_t)shapes[i].first * shapes[i].second;
+			LayerMemory m = LayerMemory();
+
+			m.layer = i;
+			m.weights = n * sizeof(double);
+			m.gradient = n * sizeof(double);
+			m.optimizer = moments * n * sizeof(double);
+			m.copies = params.__mixedPrecision ? n * sizeof(float) : 0;
+
+			if ( isCheckpoint( i, k, depth ) )
+				m.activations = (size_t)batch * shapes[i].first * perDouble;
+
+			usage.layers.push_back(m);
+		}
+
+		addLayers( usage );
+		usage.scratch = arenaSize( widths, inputs, batch, k ) * perDouble - usage.activations;
+		usage.cache = params.__cacheSize;
+
+		usage.total = usage.weights + usage.gradient + usage.optimizer + usage.copies + usage.activations + usage.scratch + usage.cache;
+		return usage;
+	}
+}
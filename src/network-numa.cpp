@@ -0,0 +1,201 @@
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 								NUMA Placement
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Implementations of the NUMA placement methods of the Network class defined in 'network.h'
+ *
+ * Only the layers using the Parallel kernel are placed; everything smaller is run by a single
+ * thread out of its cache, where it doesn't matter which node the weights came from.
+ *
+ * by jonbrennecke / https://github.com/jonbrennecke
+ *
+ */
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "network.h"
+#include "threadpool.h"
+
+namespace machine {
+
+	const NumaPlacement& Network::placement () const
+	{
+		return this->numaPlacement;
+	}
+
+	/**
+	 * give the network a pool of its own and pin its workers (the first time), then split the rows of each Parallel layer between the
+	 * nodes and bind each node's rows to it
+	 *
+	 * this is called again whenever the weights change, but only does any work for a layer whose
+	 * weight block has moved or changed shape since it was last placed
+	 */
+	void Network::placeOnNodes ()
+	{
+		const NumaTopology& topology = NumaTopology::system();
+		const int nodes = std::min( topology.nodes(), maxNumaNodes );
+		NumaPlacement& placement = this->numaPlacement;
+
+		if ( !placement.enabled )
+		{
+			// the global pool is shared with everything else in the process, so it's left unpinned
+			this->nodePool = std::make_shared<ThreadPool>( ThreadPool::global().size() );
+			ThreadPool& pool = *this->nodePool;
+
+			placement.enabled = true;
+			placement.bound = true;
+
+			for (int node = 0; node < nodes; ++node)
+				placement.cpus.push_back( topology.cpus(node) );
+
+			// deal the cpus out a node at a time, so the workers are spread evenly over the nodes;
+			// the first cpu is left for the thread that calls into the network
+			size_t widest = 0;
+			for (int node = 0; node < nodes; ++node)
+				widest = std::max( widest, topology.cpus(node).size() );
+
+			std::vector<int> order;
+			for (size_t i = 0; i < widest; ++i)
+				for (int node = 0; node < nodes; ++node)
+					if ( i < topology.cpus(node).size() )
+						order.push_back( topology.cpus(node)[i] );
+
+			for (unsigned int w = 0; w < pool.size(); ++w)
+			{
+				const int cpu = order[ ( w + 1 ) % order.size() ];
+				const bool pinned = pool.pin( w, cpu );
+
+				placement.workerCpu.push_back( pinned ? cpu : -1 );
+				placement.workerNode.push_back( topology.nodeOf(cpu) );
+			}
+		}
+
+		bool changed = false;
+
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+		{
+			Layer& layer = **it;
+
+			if ( layer.kernel != Layer::Parallel )
+			{
+				changed = changed || !layer.nodeRows.empty();
+				layer.nodeRows.clear();
+				layer.replicas.clear();
+				layer.boundWeights = nullptr;
+				continue;
+			}
+
+			if ( layer.boundWeights == layer.weights.data() && layer.nodeRows.size() == (size_t)nodes + 1 && layer.nodeRows.back() == layer.nNeurons )
+				continue;
+
+			changed = true;
+
+			// equal shares of the rows, in multiples of 8 so no two nodes write to the same cache line of the output
+			layer.nodeRows.assign( nodes + 1, layer.nNeurons );
+			for (int node = 0; node < nodes; ++node)
+				layer.nodeRows[node] = std::min( layer.nNeurons, (int)( (long long)layer.nNeurons * node / nodes ) / 8 * 8 );
+
+			for (int node = 0; node < nodes; ++node)
+			{
+				const size_t lo = (size_t)layer.nodeRows[node] * layer.nWeights;
+				const size_t hi = (size_t)layer.nodeRows[ node + 1 ] * layer.nWeights;
+
+				if ( !topology.bind( layer.weights.data() + lo, ( hi - lo ) * sizeof(double), node ) )
+					placement.bound = false;
+			}
+
+			layer.boundWeights = layer.weights.data();
+
+			// a single node reads the shared block directly; a copy would sit on the same memory
+			layer.replicas.clear();
+			if ( nodes > 1 )
+			{
+				for (int node = 0; node < nodes; ++node)
+					layer.replicas.push_back( NodeBuffer( layer.weights.size(), node ) );
+
+				layer.replicaVersion = 0;
+				layer.replica(0);
+			}
+		}
+
+		if ( !changed && !placement.layers.empty() )
+			return;
+
+		placement.layers.clear();
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+		{
+			if ( (*it)->nodeRows.empty() )
+				continue;
+
+			NumaPlacement::LayerPlacement entry;
+			entry.layer = (*it)->index;
+			entry.replicated = !(*it)->replicas.empty();
+			entry.firstRow = (*it)->nodeRows;
+			entry.replicaBytes = entry.replicated ? (*it)->weights.size() * sizeof(double) : 0;
+			placement.layers.push_back( entry );
+		}
+	}
+
+	/**
+	 * forRows on a placed layer: fn(lo, hi) a block of rows at a time, on the network's own pool
+	 *
+	 * the rows are claimed from per-node counters, and every participant starts on the rows of the
+	 * node it's running on, only moving on to other nodes' rows once its own are done
+	 */
+	void Network::Layer::forRowsOnNodes ( const std::function<void(int, int)>& fn ) const
+	{
+		static const int block = 32;
+		const NumaTopology& topology = NumaTopology::system();
+		const int nodes = this->nodeRows.size() - 1;
+		ThreadPool& pool = *this->parent.nodePool;
+
+		std::atomic<int> next[maxNumaNodes];
+		for (int k = 0; k < nodes; ++k)
+			next[k] = this->nodeRows[k];
+
+		auto claim = [&]( size_t, size_t ) {
+			const int home = std::min( topology.currentNode(), nodes - 1 );
+
+			for (int k = 0; k < nodes; ++k)
+			{
+				const int node = ( home + k ) % nodes;
+				const int end = this->nodeRows[ node + 1 ];
+
+				for (int lo = next[node].fetch_add(block); lo < end; lo = next[node].fetch_add(block))
+					fn( lo, std::min( end, lo + block ) );
+			}
+		};
+
+		pool.parallelFor( 0, pool.size() + 1, 1, std::cref(claim) );
+	}
+
+	/**
+	 * the copy of the weights on 'node', brought up to date with the weight block first if the
+	 * network's version has moved on since it was made
+	 *
+	 * the replicas were bound to their nodes when they were allocated, so it doesn't matter
+	 * which thread refreshes them
+	 */
+	const double* Network::Layer::replica ( int node ) const
+	{
+		const unsigned long long version = this->parent.version() + 1;
+
+		if ( this->replicaVersion.load() != version )
+		{
+			std::lock_guard<std::mutex> lock( this->replicaMutex );
+
+			if ( this->replicaVersion.load() != version )
+			{
+				for (auto it = this->replicas.begin(); it != this->replicas.end(); ++it)
+					std::copy( this->weights.begin(), this->weights.end(), it->data() );
+
+				this->replicaVersion = version;
+			}
+		}
+
+		return this->replicas[node].data();
+	}
+}
@@ -16,7 +16,15 @@
 #include <random>
 #include <stdexcept>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include "network.h"
+#include "cache.h"
+#include "classifier.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "threadpool.h"
 
 namespace machine {
 
@@ -26,7 +34,7 @@ namespace machine {
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	 */
 	Network::Parameters::Parameters() 
-		: __inputs(3), __outputs(5), __hiddenLayers(1), __hiddenSize(0), __biasTerm(true), __rate(0.001), actf(sigmoid), initf(random), propf(dotprod), trainf(backPropogation) {}
+		: __inputs(3), __outputs(5), __hiddenLayers(1), __hiddenSize(0), __biasTerm(true), __rate(0.001), __momentum(0.9), __decay(0.999), __epsilon(1e-8), __batchSize(1), __memoryBudget(0), __checkpointInterval(0), __mixedPrecision(false), __lossScale(1), __cacheSize(0), __numa(false), __softmaxOutput(false), actf(sigmoid), initf(nullptr), inits(uniform), __seed(0), __seeded(false), propf(dotprod), trainf(backPropogation) {}
 	
 	Network::Parameters::~Parameters() {}
 
@@ -54,18 +62,96 @@ namespace machine {
 		return *this;
 	}
 
+	Network::Parameters& Network::Parameters::layerSizes ( std::vector<unsigned int> sizes )
+	{
+		this->__layerSizes = sizes;
+		return *this;
+	}
+
 	Network::Parameters& Network::Parameters::rate ( double n )
 	{
 		this->__rate = n;
 		return *this;
 	}
 
+	Network::Parameters& Network::Parameters::momentum ( double n )
+	{
+		this->__momentum = n;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::decay ( double n )
+	{
+		this->__decay = n;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::epsilon ( double n )
+	{
+		this->__epsilon = n;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::batchSize ( int n )
+	{
+		this->__batchSize = n;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::memoryBudget ( size_t bytes )
+	{
+		this->__memoryBudget = bytes;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::checkpointInterval ( int k )
+	{
+		this->__checkpointInterval = k;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::mixedPrecision ( bool b )
+	{
+		this->__mixedPrecision = b;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::lossScale ( double s )
+	{
+		this->__lossScale = s;
+		return *this;
+	}
+
 	Network::Parameters& Network::Parameters::biasTerm ( bool b )
 	{
 		this->__biasTerm = b;
 		return *this;
 	}
 
+	Network::Parameters& Network::Parameters::telemetry ( std::string file )
+	{
+		this->__telemetry = file;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::cacheSize ( size_t n )
+	{
+		this->__cacheSize = n;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::numa ( bool b )
+	{
+		this->__numa = b;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::softmaxOutput ( bool b )
+	{
+		this->__softmaxOutput = b;
+		return *this;
+	}
+
 	Network::Parameters& Network::Parameters::activation ( ActFunction actf )
 	{
 		this->actf = actf;
@@ -78,6 +164,20 @@ namespace machine {
 		return *this;
 	}
 
+	Network::Parameters& Network::Parameters::initialization ( init_scale inits )
+	{
+		this->initf = nullptr;
+		this->inits = inits;
+		return *this;
+	}
+
+	Network::Parameters& Network::Parameters::seed ( uint64_t s )
+	{
+		this->__seed = s;
+		this->__seeded = true;
+		return *this;
+	}
+
 	Network::Parameters& Network::Parameters::propogation ( prop_handle propf )
 	{
 		this->propf = propf;
@@ -98,51 +198,378 @@ namespace machine {
 	 * construct a network from a Parameters object
 	 *
 	 */
-	Network::Network ( const Network::Parameters* params ) : params(params), training(false)
+	Network::Network ( const Network::Parameters* params ) : params(params), training(false), arenaBatch(0), checkpointEvery(1), forwardBatch(0), restoredSegment(-1), currentLossScale(params->__lossScale), cleanSteps(0), skippedStep(false), modelVersion(0), trainSteps(0), group(nullptr)
 	{
+		if ( this->params->__seeded )
+			this->initSeed = this->params->__seed;
+		else
+		{
+			std::random_device device;
+			this->initSeed = ( (uint64_t)device() << 32 ) ^ device();
+		}
+
+		if ( this->params->__cacheSize > 0 )
+			this->resultCache = std::unique_ptr<InferenceCache>( new InferenceCache( this->params->__cacheSize ) );
+
+		if ( !this->params->__telemetry.empty() )
+			this->monitor = std::unique_ptr<Telemetry>( new Telemetry( this->params->__telemetry, Telemetry::formatOf( this->params->__telemetry ) ) );
+
 		// initialize the layers
-		this->layers = std::vector<Network::Layer*>( this->params->__hiddenLayers + 2 );
+		std::vector<std::pair<int, int> > shapes = topology( *this->params );
+		for (size_t i = 0; i < shapes.size(); ++i)
+			this->layers.push_back( new Layer( shapes[i].first, shapes[i].second, *this, i ) );
+
+		this->reserve( this->params->__batchSize );
+
+		if ( this->params->__numa )
+			this->placeOnNodes();
+	}
+
+	/**
+	 * copy the weights and the shape of 'other' (after any pruning), for inference
+	 *
+	 * the optimizer state, the activation arena and the telemetry are left behind; the copy gets a
+	 * cache of its own, if the parameters ask for one, and is placed on the NUMA nodes like the original,
+	 * running on the original's pool
+	 */
+	Network::Network ( const Network& other ) : params(other.params), training(false), arenaBatch(0), checkpointEvery(1), forwardBatch(0), restoredSegment(-1), currentLossScale(other.currentLossScale), cleanSteps(0), skippedStep(false), initSeed(other.initSeed), modelVersion(0), trainSteps(0), numaPlacement(other.numaPlacement), nodePool(other.nodePool), group(nullptr)
+	{
+		if ( this->params->__cacheSize > 0 )
+			this->resultCache = std::unique_ptr<InferenceCache>( new InferenceCache( this->params->__cacheSize ) );
 
-		// for all but the input layer, the size of the weight vector is equal 
-		// to the number of neurons in the previous layer
+		for (auto it = other.layers.begin(); it != other.layers.end(); ++it)
+			this->layers.push_back( new Layer( **it, *this ) );
+
+		if ( this->params->__numa )
+			this->placeOnNodes();
+	}
+
+	Network* Network::snapshot () const
+	{
+		return new Network( *this );
+	}
+
+	/**
+	 * the shape (neurons, weights per neuron) of each layer of a network built from 'params'
+	 */
+	std::vector<std::pair<int, int> > Network::topology ( const Parameters& params )
+	{
+		std::vector<std::pair<int, int> > shapes;
+
+		// an explicit topology gives the width of every layer, each one taking the previous one's output
+		if ( !params.__layerSizes.empty() )
+		{
+			const std::vector<unsigned int>& sizes = params.__layerSizes;
+
+			if ( sizes.size() < 2 )
+				throw std::invalid_argument("Network: layerSizes needs the input size and at least one layer");
+
+			for (size_t i = 1; i < sizes.size(); ++i)
+				shapes.push_back( std::make_pair( (int)sizes[i], (int)sizes[i-1] ) );
+
+			return shapes;
+		}
+
+		// if the hiddenSize hasn't been set by the user, it should be set automatically.
+		// by default, the hidden size is equal to the floor of the mean of the number
+		// of inputs and outputs
+		int hidden = params.__hiddenSize;
+		if ( hidden == 0 )
+			hidden = (unsigned int)(( params.__inputs + params.__outputs ) * 0.5);
+
+		// the input layer is square; for all but the input layer, the size of the
+		// weight vector is equal to the number of neurons in the previous layer
+		shapes.push_back( std::make_pair( (int)params.__inputs, (int)params.__inputs ) );
+		for (unsigned int i = 0; i < params.__hiddenLayers; ++i)
+			shapes.push_back( std::make_pair( hidden, shapes.back().first ) );
+		shapes.push_back( std::make_pair( (int)params.__outputs, shapes.back().first ) );
+
+		return shapes;
+	}
+
+	// the number of neurons in each layer
+	std::vector<int> Network::widths () const
+	{
+		std::vector<int> widths;
 		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+			widths.push_back( (*it)->nNeurons );
+
+		return widths;
+	}
+
+	/**
+	 * make sure the activation arena can hold 'batch' samples, and point the layers' views into it
+	 *
+	 * this is the only place training activations are allocated; once the arena is big enough for
+	 * the largest batch, a training step doesn't touch the heap
+	 */
+	void Network::reserve ( int batch )
+	{
+		if ( batch <= this->arenaBatch )
+			return;
+
+		const int depth = this->layers.size();
+		const std::vector<int> widths = this->widths();
+
+		this->checkpointEvery = checkpointInterval( widths, this->inputs(), batch, *this->params );
+		this->arena.assign( arenaSize( widths, this->inputs(), batch, this->checkpointEvery ), 0 );
+		this->arenaBatch = batch;
+		this->restoredSegment = -1;
+
+		size_t widest = this->inputs();
+		size_t kept = this->inputs();
+		for (int i = 0; i < depth; ++i)
 		{
-			int nNeurons, nWeights;
+			widest = std::max( widest, (size_t)this->layers[i]->nNeurons );
+			if ( isCheckpoint( i, this->checkpointEvery, depth ) )
+				kept += this->layers[i]->nNeurons;
+		}
 
-			if ( it == this->layers.begin() ) // input layer
+		// the input and the checkpoints first, then the shared workspace of the layers in between
+		double* slab = this->arena.data();
+		double* workspace = slab + batch * kept;
+		double* segment = workspace;
+		const double* input = slab;
+		slab += batch * this->inputs();
+
+		for (int i = 0; i < depth; ++i)
+		{
+			Layer* layer = this->layers[i];
+			layer->input = input;
+
+			if ( isCheckpoint( i, this->checkpointEvery, depth ) )
 			{
-				nNeurons = this->params->__inputs;
-				nWeights = this->params->__inputs;
-			} 
-			else if ( it+1 == this->layers.end() ) // output layer
+				layer->output = slab;
+				slab += batch * layer->nNeurons;
+				segment = workspace;
+			}
+			else
 			{
-				nNeurons = this->params->__outputs;
-				nWeights = (*(it-1))->nNeurons;
+				layer->output = segment;
+				segment += batch * layer->nNeurons;
 			}
-			else // hidden layer
+
+			input = layer->output;
+		}
+
+		double* errors = this->arena.data() + this->arena.size() - 2 * batch * widest;
+		this->errors[0] = errors;
+		this->errors[1] = errors + batch * widest;
+
+		if ( this->params->__mixedPrecision )
+			this->arena32.assign( this->arena.size(), 0 );
+	}
+
+	// with a checkpoint every k layers, whether layer i of 'depth' keeps its own activations (the last layer always does)
+	bool Network::isCheckpoint ( int i, int k, int depth )
+	{
+		return ( i + 1 ) % k == 0 || i + 1 == depth;
+	}
+
+	/**
+	 * the interval between checkpoints for 'batch' samples through layers of the given widths
+	 *
+	 * with a budget, the smallest interval that fits recomputes the least; if nothing fits,
+	 * settle for the interval that needs the least memory
+	 */
+	int Network::checkpointInterval ( const std::vector<int>& widths, int inputs, int batch, const Parameters& params )
+	{
+		const int depth = widths.size();
+		int k = params.__checkpointInterval;
+
+		if ( k <= 0 )
+		{
+			k = 1;
+
+			if ( params.__memoryBudget > 0 )
 			{
-				// if the hiddenSize hasn't been set by the user, it should be set automatically.
-				// by default, the hidden size is equal to the floor of the mean of the number
-				// of inputs and outputs
-				if ( this->params->__hiddenSize != 0 )
-					nNeurons = this->params->__hiddenSize;
-				else
-					nNeurons = (unsigned int)(( this->params->__inputs + this->params->__outputs) * 0.5);
-
-				nWeights = (*(it-1))->nNeurons;
+				int best = 1;
+				for (k = 1; k <= depth; ++k)
+				{
+					if ( arenaSize( widths, inputs, batch, k ) * sizeof(double) <= params.__memoryBudget )
+						break;
+					if ( arenaSize( widths, inputs, batch, k ) < arenaSize( widths, inputs, batch, best ) )
+						best = k;
+				}
+
+				if ( k > depth )
+					k = best;
 			}
+		}
 
-			// create the layer
-			*it = new Layer( nNeurons, nWeights, *this, it - this->layers.begin() );
+		return std::min( k, std::max( depth, 1 ) );
+	}
+
+	// number of doubles in the arena for 'batch' samples through layers of the given widths, with a checkpoint every k layers
+	size_t Network::arenaSize ( const std::vector<int>& widths, int inputs, int batch, int k )
+	{
+		const int depth = widths.size();
+		size_t kept = inputs;
+		size_t widest = inputs;
+		size_t segment = 0, workspace = 0;
+
+		for (int i = 0; i < depth; ++i)
+		{
+			const size_t width = widths[i];
+			widest = std::max( widest, width );
+
+			if ( isCheckpoint( i, k, depth ) )
+			{
+				kept += width;
+				segment = 0;
+			}
+			else
+			{
+				segment += width;
+				workspace = std::max( workspace, segment );
+			}
 		}
-	
+
+		return batch * ( kept + workspace + 2 * widest );
 	}
 
-	Network::~Network(){};
+	// the interval between the layers whose activations are kept in training
+	int Network::checkpointInterval () const
+	{
+		return this->checkpointEvery;
+	}
 
-	void Network::load ( std::string file )
+	// size of the activation arena in bytes
+	size_t Network::activationBytes () const
 	{
+		return this->arena.size() * sizeof(double);
+	}
+
+	/**
+	 * make sure the activations of layer 'index' from the last training-mode forward pass are in the
+	 * arena, before the backward pass reads them
+	 *
+	 * with checkpointing, that means recomputing the layers of its segment from the checkpoint below
+	 * it, unless the workspace already holds that segment. The backward pass only updates a layer after
+	 * it's done with it, so the layers below are still on the weights the forward pass used.
+	 */
+	void Network::restore ( int index )
+	{
+		const int k = this->checkpointEvery;
+		const int segment = index / k;
+
+		if ( k == 1 || segment == this->restoredSegment )
+			return;
+
+		TraceSpan span( "recompute", "network", index );
 
+		for (int i = segment * k; i < index && !isCheckpoint( i, k, this->layers.size() ); ++i)
+		{
+			Layer* layer = this->layers[i];
+
+			if ( this->params->__mixedPrecision )
+				layer->forward32( this->shadow( layer->input ), this->shadow( layer->output ), this->forwardBatch );
+			else
+				layer->forward( layer->input, layer->output, this->forwardBatch );
+		}
+
+		this->restoredSegment = segment;
+	}
+
+	/**
+	 * training-mode forward pass of 'batch' samples, stored one after another in 'input'
+	 *
+	 * every layer's output is written straight into its slab of the activation arena, where the
+	 * backward pass reads it back through Layer::getInput and Layer::getOutput
+	 */
+	void Network::forward ( const double* input, int batch )
+	{
+		this->reserve( batch );
+
+		if ( this->params->__mixedPrecision )
+		{
+			// the same pass in float32, through the twin of each slab
+			std::copy( input, input + batch * this->inputs(), this->arena32.begin() );
+
+			for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+			{
+				(*it)->floats();
+				(*it)->forward32( this->shadow( (*it)->input ), this->shadow( (*it)->output ), batch );
+			}
+		}
+		else
+		{
+			std::copy( input, input + batch * this->inputs(), this->arena.begin() );
+
+			for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+				(*it)->forward( (*it)->input, (*it)->output, batch );
+		}
+
+		// the workspace is left holding the top segment
+		this->forwardBatch = batch;
+		this->restoredSegment = ( this->layers.size() - 1 ) / this->checkpointEvery;
+	}
+
+	// one of the two (batch x widest layer) error buffers used by the backward pass
+	double* Network::errorBuffer ( int i )
+	{
+		return this->errors[i];
+	}
+
+	// the float32 twin of a pointer into the activation arena, in mixed precision
+	float* Network::shadow ( const double* p )
+	{
+		return this->arena32.data() + ( p - this->arena.data() );
+	}
+
+	bool Network::mixedPrecision () const
+	{
+		return this->params->__mixedPrecision;
+	}
+
+	bool Network::softmaxOutput () const
+	{
+		return this->params->__softmaxOutput;
+	}
+
+	double Network::lossScale () const
+	{
+		return this->currentLossScale;
+	}
+
+	/**
+	 * dynamic loss scaling: after a step whose scaled gradients overflowed, halve the scale and skip
+	 * the step; after 2000 clean steps in a row, try doubling it. The scale is always a power of two
+	 * times the starting scale, so scaling and unscaling never round.
+	 *
+	 * :param overflowed - whether any gradient of the step came out infinite or NaN
+	 * :return - whether the step should be applied; a training function has to leave the weights
+	 * 		alone when it isn't, since Network::train then skips invalidating what's derived from them
+	 */
+	bool Network::scaleLoss ( bool overflowed )
+	{
+		this->skippedStep = overflowed;
+
+		if ( overflowed )
+		{
+			this->currentLossScale = std::max( this->currentLossScale / 2, 1.0 / 65536 );
+			this->cleanSteps = 0;
+			return false;
+		}
+
+		if ( ++this->cleanSteps >= 2000 )
+		{
+			this->currentLossScale = std::min( this->currentLossScale * 2, 65536.0 * 65536.0 );
+			this->cleanSteps = 0;
+		}
+
+		return true;
+	}
+
+	Network::~Network()
+	{
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+			delete (*it);
+	}
+
+	void Network::load ( std::string file )
+	{
+		this->weightsChanged();
 	}
 
 	// 
@@ -185,10 +612,128 @@ namespace machine {
 	 */
 	std::vector<double> Network::feedForward ( std::vector<double> feed )
 	{
+		// in training mode the layers record their inputs and outputs in the arena
+		if ( this->training )
+		{
+			if ( (int)feed.size() != this->inputs() )
+				throw std::invalid_argument("Network::feedForward: the input doesn't match the size of the input layer");
+
+			this->forward( feed.data(), 1 );
+			ActivationView out = this->layers.back()->getOutput();
+
+			if ( this->params->__mixedPrecision )
+			{
+				const float* out32 = this->shadow( out.begin() );
+				return std::vector<double>( out32, out32 + out.size() );
+			}
+
+			return std::vector<double>( out.begin(), out.end() );
+		}
+
+		bool cached = !!this->resultCache;
+		unsigned long long version = this->version();
+		std::vector<double> input;
+
+		if ( cached )
+		{
+			std::vector<double> output;
+			if ( this->resultCache->lookup( feed, version, output ) )
+				return output;
+
+			input = feed;
+		}
+
 		// iterate through the layers, transforming the input vector by the neurons in each layer
 		for (auto it = layers.begin(); it != layers.end(); ++it)
 			feed = (*it)->feedForward( feed );
 
+		// the result is tagged with the version read before the pass, so a concurrent update can't
+		// leave an output computed against the old weights in the cache under the new version
+		if ( cached )
+			this->resultCache->insert( input, version, feed );
+
+		return feed;
+	}
+
+	/**
+	 * feed a batch of input vectors forward through the network
+	 *
+	 * the batch is packed into one contiguous block, so that each layer's kernel sees the whole
+	 * batch at once and can reuse its weights across samples
+	 */
+	std::vector<std::vector<double> > Network::feedForward ( const std::vector<std::vector<double> >& batch )
+	{
+		const int n = batch.size();
+		int width = this->inputs();
+
+		std::vector<double> feed( n * width );
+		for (int b = 0; b < n; ++b)
+		{
+			if ( (int)batch[b].size() != width )
+				throw std::invalid_argument("Network::feedForward: the input doesn't match the size of the input layer");
+
+			std::copy( batch[b].begin(), batch[b].end(), feed.begin() + b * width );
+		}
+
+		std::vector<double> next;
+		for (auto it = layers.begin(); it != layers.end(); ++it)
+		{
+			next.resize( n * (*it)->nNeurons );
+			(*it)->forward( feed.data(), next.data(), n );
+			feed.swap(next);
+			width = (*it)->nNeurons;
+		}
+
+		std::vector<std::vector<double> > result(n);
+		for (int b = 0; b < n; ++b)
+			result[b] = std::vector<double>( feed.begin() + b * width, feed.begin() + (b + 1) * width );
+
+		return result;
+	}
+
+	/**
+	 * feed a sparse input vector forward through the network
+	 *
+	 * instead of a dot product over every input, the first layer is computed by gathering the
+	 * weight columns of the nonzero inputs only (from the layer's column-major copy), so its cost
+	 * scales with the number of nonzeros rather than the width of the input. The rest of the
+	 * network is dense as usual.
+	 *
+	 * the results match feedForward on the equivalent dense vector exactly when the pairs are in
+	 * increasing index order (the terms are then summed in the same order, minus the zeros)
+	 */
+	std::vector<double> Network::feedForwardSparse ( const sparse_vector& input )
+	{
+		Layer& first = *this->layers.front();
+
+		if ( first.kernel == Layer::Generic )
+			throw std::logic_error("Network::feedForwardSparse: not supported with a custom propogation function");
+
+		const int rows = first.nNeurons;
+		const double* columns = first.columns();
+
+		std::vector<double> feed( rows, 0 );
+		double* sum = feed.data();
+
+		for (auto it = input.begin(); it != input.end(); ++it)
+		{
+			if ( it->first < 0 || it->first >= first.nWeights )
+				throw std::out_of_range("Network::feedForwardSparse: index outside of the input vector");
+
+			const double value = it->second;
+			const double* column = columns + it->first * rows;
+
+			for (int i = 0; i < rows; ++i)
+				sum[i] += value * column[i];
+		}
+
+		const ActFunction& actf = this->activate(0);
+		for (int i = 0; i < rows; ++i)
+			sum[i] = actf.dxdy( sum[i] );
+
+		for (auto it = this->layers.begin() + 1; it != this->layers.end(); ++it)
+			feed = (*it)->feedForward( feed );
+
 		return feed;
 	}
 
@@ -204,14 +749,148 @@ namespace machine {
 		return (*this->params->initf)();
 	}
 
-	// call the training method of the trainer class
+	/**
+	 * call the training method of the trainer class
+	 *
+	 * the training function's forward pass records the input and output of each layer in the arena,
+	 * which only happens in training mode, so the step is run in training mode; the caller's mode is
+	 * put back afterwards (even if the step throws), so that a feedForward after training still uses
+	 * the result cache and the inference kernels
+	 */
 	std::vector<double> Network::train ( std::vector<double> input, std::vector<double> expected )
 	{
-		// when the network is in 'training mode' the input to each neuron will be stored
-		if ( !this->training )
-			this->toggleTrainingMode();
+		const bool wasTraining = this->training;
+		const int batch = std::max<int>( input.size() / std::max( this->inputs(), 1 ), 1 );
+
+		// the trainer takes 'expected', so the record's copy goes in a buffer that keeps its capacity between steps
+		if ( this->monitor )
+			this->stepTarget.assign( expected.begin(), expected.end() );
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<double> result;
+
+		this->training = true;
+		this->skippedStep = false;
+
+		try
+		{
+			result = (*this->params->trainf)( std::move(input), std::move(expected), *this );
+		}
+		catch ( ... )
+		{
+			// the step may have got as far as updating some of the layers
+			this->training = wasTraining;
+			this->weightsChanged(true);
+			throw;
+		}
+
+		this->training = wasTraining;
+
+		// a step the loss scale held back left the weights, and so everything derived from them, as they were
+		if ( !this->skippedStep )
+			this->weightsChanged(true);
+
+		if ( this->monitor )
+		{
+			const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+			this->recordStep( this->stepTarget, result, batch, seconds );
+		}
+
+		return result;
+	}
+
+	/**
+	 * hand a record of the step that just finished to the telemetry thread
+	 *
+	 * the loss and the gradient norm are read off what the step left behind (the outputs it
+	 * returned, and each layer's gradient) outside of the timed part of the step. Summing the
+	 * squares of every gradient costs as much as a few percent of a small step, so the norm is
+	 * only measured every 'normEvery' steps; the records in between carry NaN.
+	 */
+	void Network::recordStep ( const std::vector<double>& expected, const std::vector<double>& output, int batch, double seconds )
+	{
+		TrainingRecord r;
+		r.step = ++this->trainSteps;
+		r.batch = batch;
+		r.seconds = seconds;
+		r.samplesPerSecond = seconds > 0 ? batch / seconds : 0;
+		r.rate = this->rate();
+
+		// the loss training minimizes: half the squared error (backprop's gradient is output - expected),
+		// or the softmax cross-entropy of the logits
+		double loss = 0;
+		if ( this->params->__softmaxOutput )
+		{
+			const size_t n = this->outputs();
+			for (size_t o = 0; o + n <= expected.size() && o + n <= output.size(); o += n)
+				loss += softmaxCrossEntropy( output.data() + o, n, expected.data() + o, nullptr );
+		}
+		else
+		{
+			for (size_t i = 0; i < expected.size() && i < output.size(); ++i)
+				loss += 0.5 * ( output[i] - expected[i] ) * ( output[i] - expected[i] );
+		}
+		r.loss = loss / batch;
+
+		const unsigned long long normEvery = 8;
+		r.gradientNorm = std::numeric_limits<double>::quiet_NaN();
+		if ( r.step % normEvery != 1 )
+		{
+			this->monitor->record(r);
+			return;
+		}
+
+		double norm = 0;
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+		{
+			const std::vector<double>& g = (*it)->gradient;
+			double s[4] = { 0, 0, 0, 0 };
+			size_t i = 0;
+
+			for (; i + 4 <= g.size(); i += 4)
+				for (int l = 0; l < 4; ++l)
+					s[l] += g[ i + l ] * g[ i + l ];
+			for (; i < g.size(); ++i)
+				s[0] += g[i] * g[i];
+
+			norm += ( s[0] + s[1] ) + ( s[2] + s[3] );
+		}
+		r.gradientNorm = std::sqrt(norm);
+
+		this->monitor->record(r);
+	}
+
+	/**
+	 * called whenever the weights have been modified, to invalidate anything derived from them
+	 *
+	 * :param trained - the weights were moved by a training step, rather than replaced or reshaped; a layer
+	 * 		on the sparse kernel then keeps its sparsity pattern (see Layer::refreshSparse), where otherwise
+	 * 		its sparse copy is dropped
+	 * :param layers - the layers that were replaced or reshaped, when 'trained' isn't set (default is all of
+	 * 		them); the sparse copies of the others still match their weights, so they're left as they are
+	 */
+	void Network::weightsChanged ( bool trained, const std::vector<int>& layers )
+	{
+		++this->modelVersion;
+
+		// the sparse copies of pruned layers no longer match their weights
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+		{
+			if ( (*it)->kernel != Layer::Sparse )
+				continue;
 
-		return (*this->params->trainf)( input, expected, *this );
+			if ( trained )
+				(*it)->refreshSparse();
+			else if ( layers.empty() || std::find( layers.begin(), layers.end(), (*it)->index ) != layers.end() )
+				(*it)->densify();
+		}
+
+		if ( this->resultCache )
+			this->resultCache->clear();
+
+		// pruning can resize a layer or change its kernel
+		if ( this->params->__numa )
+			this->placeOnNodes();
 	}
 
 	// return the activation function
@@ -220,22 +899,87 @@ namespace machine {
 		return this->params->actf;
 	}
 
+	// return the activation function of layer 'l'; a softmax output layer has none
+	const ActFunction& Network::activate ( int l )
+	{
+		if ( this->params->__softmaxOutput && l + 1 == (int)this->layers.size() )
+			return identity;
+
+		return this->params->actf;
+	}
+
 	// return the number of layers in the network
 	int Network::size () const
 	{
 		return this->layers.size();
 	}
 
+	// return the size of the input vector
+	int Network::inputs () const
+	{
+		return this->layers.front()->nWeights;
+	}
+
+	// return the size of the output vector
+	int Network::outputs () const
+	{
+		return this->layers.back()->size();
+	}
+
 	// return the learning rate
 	double Network::rate () const
 	{
 		return this->params->__rate;
 	}
 
+	// return the optimizer hyperparameters
+	double Network::momentum () const
+	{
+		return this->params->__momentum;
+	}
+
+	double Network::decay () const
+	{
+		return this->params->__decay;
+	}
+
+	double Network::epsilon () const
+	{
+		return this->params->__epsilon;
+	}
+
+	// return the version of the weights, which is incremented every time they are modified
+	unsigned long long Network::version () const
+	{
+		return this->modelVersion.load();
+	}
+
+	uint64_t Network::seed () const
+	{
+		return this->initSeed;
+	}
+
+	// return the feedForward result cache, or nullptr if caching is disabled
+	InferenceCache* Network::cache ()
+	{
+		return this->resultCache.get();
+	}
+
+	// the telemetry of the training steps, or nullptr if it's disabled
+	Telemetry* Network::telemetry ()
+	{
+		return this->monitor.get();
+	}
+
 	// toggle the training bool
 	void Network::toggleTrainingMode ()
 	{
-		this->training = ~this->training;
+		this->training = !this->training;
+	}
+
+	bool Network::trainingMode () const
+	{
+		return this->training;
 	}
 
 	// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -290,15 +1034,248 @@ namespace machine {
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	 */
 	Network::Layer::Layer ( int nNeurons, int nWeights, Network &parent, int index ) 
-		: index(index), parent(parent), nNeurons(nNeurons), nWeights(nWeights)
+		: index(index), updates(0), transposedVersion(0), boundWeights(nullptr), replicaVersion(0), parent(parent), nNeurons(nNeurons), nWeights(nWeights), weights32Version(0), input(nullptr), output(nullptr)
 	{
+		this->weights = std::vector<double>( this->nNeurons * this->nWeights );
+
+		if ( this->parent.params->initf )
+		{
+			// an init_handle is called once per weight, row by row
+			for (auto it = this->weights.begin(); it != this->weights.end(); ++it)
+				(*it) = this->parent.init();
+		}
+		else
+		{
+			// every weight of a scaled initializer is independent, so the rows can be filled in parallel
+			const int rows = this->nNeurons, cols = this->nWeights;
+			double* weights = this->weights.data();
+			const uint64_t seed = this->parent.initSeed;
+			const init_scale scale = this->parent.params->inits;
+
+			auto fill = [&]( size_t lo, size_t hi ) {
+				initializeBlock( weights, rows, cols, lo, hi, index, seed, scale );
+			};
+
+			ThreadPool::global().parallelFor( 0, rows, std::max( 1, ( 1 << 14 ) / std::max( cols, 1 ) ), std::cref(fill) );
+		}
+
 		this->neurons = std::vector<Layer::Neuron *>(this->nNeurons);
 
 		for (auto it = neurons.begin(); it != neurons.end(); ++it)
-			(*it) = new Layer::Neuron( this->nWeights, parent );
+			(*it) = new Layer::Neuron( it - neurons.begin(), *this );
+
+		this->selectKernel();
 	}
 
-	Network::Layer::~Layer(){}
+	// layers smaller than this many weights use the MatVec kernel (the whole block fits in L1)
+	static const int blockedThreshold = 1 << 12;
+
+	// layers with at least this many weights use the Parallel kernel
+	static const int parallelThreshold = 1 << 16;
+
+	// choose the propogation kernel from the shape of the layer
+	void Network::Layer::selectKernel()
+	{
+		const int n = this->nNeurons * this->nWeights;
+
+		if ( this->parent.params->propf != dotprod )
+			this->kernel = Generic;
+		else if ( n < blockedThreshold )
+			this->kernel = MatVec;
+		else if ( n < parallelThreshold || ThreadPool::global().size() == 0 || this->nNeurons < 8 )
+			this->kernel = Blocked;
+		else
+			this->kernel = Parallel;
+	}
+
+	// build the compressed sparse row copy of the weights, and switch to the sparse kernel
+	void Network::Layer::sparsify()
+	{
+		this->sparseRows.assign( 1, 0 );
+		this->sparseColumns.clear();
+		this->sparseValues.clear();
+
+		const double* row = this->weights.data();
+		for (int i = 0; i < this->nNeurons; ++i, row += this->nWeights)
+		{
+			for (int j = 0; j < this->nWeights; ++j)
+			{
+				if ( row[j] != 0 )
+				{
+					this->sparseColumns.push_back(j);
+					this->sparseValues.push_back( row[j] );
+				}
+			}
+
+			this->sparseRows.push_back( this->sparseValues.size() );
+		}
+
+		this->kernel = Sparse;
+	}
+
+	/**
+	 * training moves every weight, the pruned ones included: zero the weights outside the sparsity
+	 * pattern again, and refresh the sparse copy's values from the rest, so that the layer stays
+	 * pruned and on the sparse kernel
+	 */
+	void Network::Layer::refreshSparse()
+	{
+		double* row = this->weights.data();
+		for (int i = 0; i < this->nNeurons; ++i, row += this->nWeights)
+		{
+			int j = 0;
+			for (int k = this->sparseRows[i]; k < this->sparseRows[i+1]; ++k)
+			{
+				const int column = this->sparseColumns[k];
+				for (; j < column; ++j)
+					row[j] = 0;
+
+				this->sparseValues[k] = row[column];
+				j = column + 1;
+			}
+
+			for (; j < this->nWeights; ++j)
+				row[j] = 0;
+		}
+	}
+
+	// drop the sparse copy and go back to the dense kernel for the layer's shape
+	void Network::Layer::densify()
+	{
+		std::vector<int>().swap( this->sparseRows );
+		std::vector<int>().swap( this->sparseColumns );
+		std::vector<double>().swap( this->sparseValues );
+
+		this->selectKernel();
+	}
+
+	/**
+	 * the column-major copy of the weight block
+	 *
+	 * the copy is rebuilt lazily the first time it's asked for after the weights change, so layers
+	 * that are never fed sparse inputs never pay for it
+	 */
+	const double* Network::Layer::columns()
+	{
+		// offset by one, so that a version of 0 means the copy has never been built
+		const unsigned long long version = this->parent.version() + 1;
+
+		if ( this->transposedVersion.load( std::memory_order_acquire ) != version )
+		{
+			std::lock_guard<std::mutex> lock( this->transposedMutex );
+
+			if ( this->transposedVersion.load( std::memory_order_relaxed ) != version )
+			{
+				this->transposed.resize( this->weights.size() );
+
+				// transpose in 32 x 32 tiles, so that both the reads and the writes stay within a few cache lines
+				const int rows = this->nNeurons, cols = this->nWeights;
+				const double* w = this->weights.data();
+				double* t = this->transposed.data();
+
+				for (int i0 = 0; i0 < rows; i0 += 32)
+					for (int j0 = 0; j0 < cols; j0 += 32)
+						for (int i = i0; i < std::min( rows, i0 + 32 ); ++i)
+							for (int j = j0; j < std::min( cols, j0 + 32 ); ++j)
+								t[ j * rows + i ] = w[ i * cols + j ];
+
+				this->transposedVersion.store( version, std::memory_order_release );
+			}
+		}
+
+		return this->transposed.data();
+	}
+
+	// the float32 copy of the weights, brought up to date first if the version has moved on
+	const float* Network::Layer::floats()
+	{
+		const unsigned long long version = this->parent.version() + 1;
+
+		if ( this->weights32Version != version )
+		{
+			this->weights32.assign( this->weights.begin(), this->weights.end() );
+			this->weights32Version = version;
+		}
+
+		return this->weights32.data();
+	}
+
+	// number of nonzero weights
+	int Network::Layer::nonzeros() const
+	{
+		return this->weights.size() - std::count( this->weights.begin(), this->weights.end(), 0.0 );
+	}
+
+	/**
+	 * register-blocked GEMM over rows [lo, hi) of the weight block
+	 *
+	 * the rows are visited in tiles of roughly 256KB of weights, and within a tile each weight row
+	 * is applied to 4 samples at a time, so every weight loaded is used 4 times. Each output is still
+	 * a single running sum over the row, in order, exactly as 'dot' computes it.
+	 */
+	static void blockedKernel ( const double* weights, int rows, int cols, const double* input, double* output, int batch, int lo, int hi, const ActFunction& actf )
+	{
+		const int tile = std::max( 1, ( 1 << 15 ) / std::max( cols, 1 ) );
+
+		for (int r0 = lo; r0 < hi; r0 += tile)
+		{
+			const int r1 = std::min( hi, r0 + tile );
+			int b = 0;
+
+			for (; b + 4 <= batch; b += 4)
+			{
+				const double* x0 = input + b * cols;
+				const double* x1 = x0 + cols;
+				const double* x2 = x1 + cols;
+				const double* x3 = x2 + cols;
+
+				for (int i = r0; i < r1; ++i)
+				{
+					const double* w = weights + i * cols;
+					double a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+
+					for (int j = 0; j < cols; ++j)
+					{
+						const double wj = w[j];
+						a0 += x0[j] * wj;
+						a1 += x1[j] * wj;
+						a2 += x2[j] * wj;
+						a3 += x3[j] * wj;
+					}
+
+					output[ b * rows + i ] = actf.dxdy(a0);
+					output[ (b + 1) * rows + i ] = actf.dxdy(a1);
+					output[ (b + 2) * rows + i ] = actf.dxdy(a2);
+					output[ (b + 3) * rows + i ] = actf.dxdy(a3);
+				}
+			}
+
+			for (; b < batch; ++b)
+				for (int i = r0; i < r1; ++i)
+					output[ b * rows + i ] = actf.dxdy( dot( input + b * cols, weights + i * cols, cols ) );
+		}
+	}
+
+	// copy the weights of 'other' into a layer of 'parent', with the same kernel
+	Network::Layer::Layer ( const Layer& other, Network& parent )
+		: index(other.index), weights(other.weights), updates(0), transposedVersion(0), boundWeights(nullptr), replicaVersion(0), parent(parent), nNeurons(other.nNeurons), nWeights(other.nWeights), weights32Version(0), input(nullptr), output(nullptr)
+	{
+		this->neurons = std::vector<Layer::Neuron *>(this->nNeurons);
+
+		for (auto it = neurons.begin(); it != neurons.end(); ++it)
+			(*it) = new Layer::Neuron( it - neurons.begin(), *this );
+
+		if ( other.kernel == Sparse )
+			this->sparsify();
+		else
+			this->selectKernel();
+	}
+
+	Network::Layer::~Layer()
+	{
+		for (auto it = this->neurons.begin(); it != this->neurons.end(); ++it)
+			delete (*it);
+	}
 
 	/**
 	 * feed 'input' to the layer and return a the resulting vector
@@ -309,32 +1286,203 @@ namespace machine {
 	 */
 	std::vector<double> Network::Layer::feedForward ( std::vector<double> input )
 	{
-		std::vector<double> output(this->neurons.size());
+		if ( (int)input.size() != this->nWeights )
+			throw std::invalid_argument("Layer::feedForward: the input doesn't match the size of the layer's weight vectors");
 
-		auto it2 = output.begin();
+		std::vector<double> output(this->nNeurons);
+		this->forward( input.data(), output.data(), 1 );
 
-		for (auto it = this->neurons.begin(); it != this->neurons.end(); ++it, ++it2 )
-			(*it2) = this->parent.activate().dxdy( this->parent.propogate( input, (*it)->weights ) );
+		return output;
+	}
+
+	/**
+	 * the propogation kernel: transform 'batch' input vectors of length nWeights, stored one after
+	 * another in 'input', into 'batch' output vectors of length nNeurons in 'output'
+	 */
+	void Network::Layer::forward ( const double* input, double* output, int batch ) const
+	{
+		TraceSpan span( "forward", "layer", this->index );
+		const ActFunction& actf = this->parent.activate( this->index );
+		const double* weights = this->weights.data();
+		const int rows = this->nNeurons;
+		const int cols = this->nWeights;
 
-		// when the network is in 'training mode' the input and output to each neuron should be stored
-		if ( this->parent.training ) {
-			this->input = std::vector<double>(input);
-			this->output = std::vector<double>(output);
+		switch ( this->kernel )
+		{
+			case MatVec :
+			{
+				for (int b = 0; b < batch; ++b, input += cols)
+				{
+					const double* row = weights;
+					for (int i = 0; i < rows; ++i, row += cols)
+						*output++ = actf.dxdy( dot( input, row, cols ) );
+				}
+				break;
+			}
+			case Blocked :
+				blockedKernel( weights, rows, cols, input, output, batch, 0, rows, actf );
+				break;
+			case Parallel :
+			{
+				if ( !this->nodeRows.empty() )
+				{
+					this->numaForward( input, output, batch );
+					break;
+				}
+
+				// split the rows evenly, in multiples of 8 so neighbouring threads don't share cache lines of the output;
+				// the kernel is passed by reference, since a std::function of a lambda this size would allocate
+				auto kernel = [&]( size_t lo, size_t hi ) {
+					blockedKernel( weights, rows, cols, input, output, batch, lo * 8, std::min( rows, (int)hi * 8 ), actf );
+				};
+
+				ThreadPool::global().parallelFor( 0, ( rows + 7 ) / 8, 1, std::cref(kernel) );
+				break;
+			}
+			case Sparse :
+			{
+				// 4 samples at a time, so each nonzero and its column index are loaded once per 4 samples
+				const int* start = this->sparseRows.data();
+				const int* column = this->sparseColumns.data();
+				const double* value = this->sparseValues.data();
+				int b = 0;
+
+				for (; b + 4 <= batch; b += 4)
+				{
+					const double* x0 = input + b * cols;
+					const double* x1 = x0 + cols;
+					const double* x2 = x1 + cols;
+					const double* x3 = x2 + cols;
+
+					for (int i = 0; i < rows; ++i)
+					{
+						double a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+
+						for (int k = start[i]; k < start[i+1]; ++k)
+						{
+							const int j = column[k];
+							const double w = value[k];
+							a0 += x0[j] * w;
+							a1 += x1[j] * w;
+							a2 += x2[j] * w;
+							a3 += x3[j] * w;
+						}
+
+						output[ b * rows + i ] = actf.dxdy(a0);
+						output[ (b + 1) * rows + i ] = actf.dxdy(a1);
+						output[ (b + 2) * rows + i ] = actf.dxdy(a2);
+						output[ (b + 3) * rows + i ] = actf.dxdy(a3);
+					}
+				}
+
+				for (; b < batch; ++b)
+				{
+					const double* x = input + b * cols;
+
+					for (int i = 0; i < rows; ++i)
+					{
+						double a = 0;
+						for (int k = start[i]; k < start[i+1]; ++k)
+							a += x[ column[k] ] * value[k];
+
+						output[ b * rows + i ] = actf.dxdy(a);
+					}
+				}
+				break;
+			}
+			case Generic :
+			{
+				// a user supplied propogation function is called through its handle, with a copy of each row
+				for (int b = 0; b < batch; ++b, input += cols)
+				{
+					const double* row = weights;
+					std::vector<double> in( input, input + cols );
+					for (int i = 0; i < rows; ++i, row += cols)
+						*output++ = actf.dxdy( this->parent.propogate( in, std::vector<double>( row, row + cols ) ) );
+				}
+				break;
+			}
 		}
+	}
 
-		return output;
+	/**
+	 * the Parallel kernel, with the rows split between the nodes by forRows
+	 *
+	 * in training the rows are read from the shared weight block, whose pages for those rows live on
+	 * the node that works on them, and otherwise from the copy on the node the block runs on
+	 */
+	void Network::Layer::numaForward ( const double* input, double* output, int batch ) const
+	{
+		const ActFunction& actf = this->parent.activate( this->index );
+		const NumaTopology& topology = NumaTopology::system();
+		const int nodes = this->nodeRows.size() - 1;
+		const bool replicated = !this->parent.training && !this->replicas.empty();
+
+		this->forRows( [&]( int lo, int hi ) {
+			const double* weights = replicated ? this->replica( std::min( topology.currentNode(), nodes - 1 ) ) : this->weights.data();
+			blockedKernel( weights, this->nNeurons, this->nWeights, input, output, batch, lo, hi, actf );
+		});
 	}
 
-	// get the input vector
-	std::vector<double> Network::Layer::getInput()
+	// float32 dot product, split over 8 accumulators so the compiler can keep them in one vector register
+	static float dot32 ( const float* a, const float* b, int n )
 	{
-		return this->input;
+		float acc[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		int j = 0;
+
+		for (; j + 8 <= n; j += 8)
+			for (int l = 0; l < 8; ++l)
+				acc[l] += a[ j + l ] * b[ j + l ];
+
+		float sum = ( ( acc[0] + acc[4] ) + ( acc[1] + acc[5] ) ) + ( ( acc[2] + acc[6] ) + ( acc[3] + acc[7] ) );
+		for (; j < n; ++j)
+			sum += a[j] * b[j];
+
+		return sum;
 	}
 
-	// get the output vector
-	std::vector<double> Network::Layer::getOutput()
+	/**
+	 * the propogation kernel of mixed precision training, on the float32 copy of the weights
+	 * (which 'floats' has to have brought up to date)
+	 *
+	 * half the bytes per weight, and twice as many lanes per vector register as the double kernels
+	 */
+	void Network::Layer::forward32 ( const float* input, float* output, int batch ) const
+	{
+		TraceSpan span( "forward32", "layer", this->index );
+		const ActFunction& actf = this->parent.activate( this->index );
+		const float* weights = this->weights32.data();
+		const int rows = this->nNeurons;
+		const int cols = this->nWeights;
+
+		auto kernel = [&]( size_t lo, size_t hi ) {
+			for (int b = 0; b < batch; ++b)
+				for (size_t i = lo; i < hi; ++i)
+					output[ b * rows + i ] = (float)actf.dxdy( dot32( input + b * cols, weights + i * cols, cols ) );
+		};
+
+		if ( this->kernel == Parallel )
+			ThreadPool::global().parallelFor( 0, rows, 8, std::cref(kernel) );
+		else
+			kernel( 0, rows );
+	}
+
+	// get a pointer to the weight block
+	double* Network::Layer::data()
+	{
+		return this->weights.data();
+	}
+
+	// get the input vector of sample 'b' of the last training step
+	ActivationView Network::Layer::getInput( int b ) const
+	{
+		return ActivationView{ this->input + b * this->nWeights, (size_t)this->nWeights };
+	}
+
+	// get the output vector of sample 'b' of the last training step
+	ActivationView Network::Layer::getOutput( int b ) const
 	{
-		return this->output;
+		return ActivationView{ this->output + b * this->nNeurons, (size_t)this->nNeurons };
 	}
 
 	// get the size of the layer
@@ -393,25 +1541,19 @@ namespace machine {
 	 * 					Neuron
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	 */
-	Network::Layer::Neuron::Neuron ( int nWeights, Network &parent ) 
-		: parent(parent), nWeights(nWeights)
-	{
-		this->weights = std::vector<double>(this->nWeights);
-
-		for (auto it = this->weights.begin(); it != this->weights.end(); ++it)
-			(*it) = this->parent.init();
-	}
+	Network::Layer::Neuron::Neuron ( int index, Layer &layer ) 
+		: layer(layer), index(index) {}
 
 	Network::Layer::Neuron::~Neuron(){}
 
 	std::vector<double>::iterator Network::Layer::Neuron::begin()
 	{
-		return this->weights.begin();
+		return this->layer.weights.begin() + this->index * this->layer.nWeights;
 	}
 
 	std::vector<double>::iterator Network::Layer::Neuron::end()
 	{
-		return this->weights.end();
+		return this->begin() + this->layer.nWeights;
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,416 @@
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 								Network Pruning
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * Implementations of the pruning methods of the Network class defined in 'network.h'
+ *
+ * by jonbrennecke / https://github.com/jonbrennecke
+ *
+ */
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include "network.h"
+
+namespace machine {
+
+	// the layers a pruning call applies to: the ones listed, or all of them
+	static std::vector<int> selectedLayers ( const std::vector<int>& layers, int size )
+	{
+		if ( !layers.empty() )
+		{
+			for (auto it = layers.begin(); it != layers.end(); ++it)
+				if ( *it < 0 || *it >= size )
+					throw std::out_of_range("Network::prune: no such layer");
+
+			return layers;
+		}
+
+		std::vector<int> all(size);
+		for (int i = 0; i < size; ++i)
+			all[i] = i;
+
+		return all;
+	}
+
+	// average time of one pass of a sample through the layer with its current kernel
+	static double timeLayer ( const Network::Layer& layer, const std::vector<double>& input, std::vector<double>& output )
+	{
+		typedef std::chrono::steady_clock clock;
+
+		// repeat until the measurement is long enough to trust
+		int reps = 0;
+		clock::time_point start = clock::now();
+		std::chrono::duration<double> elapsed;
+
+		do
+		{
+			layer.forward( input.data(), output.data(), 1 );
+			++reps;
+			elapsed = clock::now() - start;
+		}
+		while ( elapsed.count() < 2e-3 );
+
+		return elapsed.count() / reps;
+	}
+
+	/**
+	 * zero every weight with a magnitude below 'threshold' in the selected layers (all layers by
+	 * default), then convert each of those layers to the sparse kernel if that's faster
+	 *
+	 * a converted layer keeps its sparsity through later training: after every step the weights it
+	 * was pruned of are zeroed again (see Network::weightsChanged). Pruning it again, loading or
+	 * broadcasting new weights, or removing neurons from it or the layer below, puts it back on a
+	 * dense kernel; pruning other layers leaves it be.
+	 *
+	 * :return - a report for each selected layer
+	 */
+	std::vector<Network::PruneReport> Network::prune ( double threshold, std::vector<int> layers )
+	{
+		layers = selectedLayers( layers, this->size() );
+
+		for (auto it = layers.begin(); it != layers.end(); ++it)
+		{
+			std::vector<double>& w = this->layers[*it]->weights;
+
+			for (auto weight = w.begin(); weight != w.end(); ++weight)
+				if ( std::fabs(*weight) < threshold )
+					*weight = 0;
+		}
+
+		this->weightsChanged( false, layers );
+		return this->convertToSparse( layers );
+	}
+
+	/**
+	 * zero the smallest magnitude weights of each selected layer (all layers by default) until
+	 * a fraction 'target' of them is zero, then convert the layers to the sparse kernel if that's faster
+	 *
+	 * :return - a report for each selected layer
+	 */
+	std::vector<Network::PruneReport> Network::pruneToSparsity ( double target, std::vector<int> layers )
+	{
+		if ( target < 0 || target > 1 )
+			throw std::invalid_argument("Network::pruneToSparsity: the target should be between 0 and 1");
+
+		layers = selectedLayers( layers, this->size() );
+
+		for (auto it = layers.begin(); it != layers.end(); ++it)
+		{
+			std::vector<double>& w = this->layers[*it]->weights;
+			size_t k = (size_t)( target * w.size() );
+
+			if ( k == 0 )
+				continue;
+
+			// order the weights by magnitude, and zero the k smallest
+			std::vector<size_t> order( w.size() );
+			for (size_t i = 0; i < order.size(); ++i)
+				order[i] = i;
+
+			std::nth_element( order.begin(), order.begin() + ( k - 1 ), order.end(), [&w]( size_t a, size_t b ) {
+				return std::fabs( w[a] ) < std::fabs( w[b] );
+			});
+
+			for (size_t i = 0; i < k; ++i)
+				w[ order[i] ] = 0;
+		}
+
+		this->weightsChanged( false, layers );
+		return this->convertToSparse( layers );
+	}
+
+	// build the sparse copy of each layer, and keep it only where it beats the dense kernel
+	std::vector<Network::PruneReport> Network::convertToSparse ( const std::vector<int>& layers )
+	{
+		std::vector<PruneReport> reports;
+
+		for (auto it = layers.begin(); it != layers.end(); ++it)
+		{
+			Layer& layer = *this->layers[*it];
+
+			std::vector<double> input( layer.nWeights );
+			std::vector<double> output( layer.nNeurons );
+			for (size_t i = 0; i < input.size(); ++i)
+				input[i] = std::sin( (double)i );
+
+			PruneReport report;
+			report.layer = *it;
+			report.weights = layer.weights.size();
+			report.nonzeros = layer.nonzeros();
+			report.sparsity = 1 - (double)report.nonzeros / std::max( report.weights, 1 );
+
+			// layers using a custom propogation function can't be made sparse
+			if ( layer.kernel == Layer::Generic )
+			{
+				report.denseSeconds = report.sparseSeconds = timeLayer( layer, input, output );
+				report.speedup = 1;
+				report.converted = false;
+				reports.push_back(report);
+				continue;
+			}
+
+			report.denseSeconds = timeLayer( layer, input, output );
+			layer.sparsify();
+			report.sparseSeconds = timeLayer( layer, input, output );
+			report.speedup = report.denseSeconds / report.sparseSeconds;
+			report.converted = report.speedup > 1;
+
+			if ( !report.converted )
+				layer.densify();
+
+			reports.push_back(report);
+		}
+
+		return reports;
+	}
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 			Structured pruning
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * whole neurons are removed, so the network gets genuinely smaller and keeps using the dense kernels
+	 */
+
+	// keep only the rows and columns of a row-major block that are flagged in 'keepRows' and 'keepCols'
+	static void sliceBlock ( std::vector<double>& block, const std::vector<bool>& keepRows, const std::vector<bool>& keepCols )
+	{
+		const size_t cols = keepCols.size();
+
+		// blocks that don't have the layer's shape (eg. optimizer state that was never allocated) are just dropped
+		if ( block.size() != keepRows.size() * cols )
+		{
+			block.clear();
+			return;
+		}
+
+		size_t out = 0;
+		for (size_t i = 0; i < keepRows.size(); ++i)
+		{
+			if ( !keepRows[i] )
+				continue;
+
+			for (size_t j = 0; j < cols; ++j)
+				if ( keepCols[j] )
+					block[out++] = block[ i * cols + j ];
+		}
+
+		block.resize(out);
+	}
+
+	/**
+	 * remove the given neurons from layer 'index', along with the matching columns of the next layer's weights
+	 *
+	 * the output layer can't be pruned, since its neurons are the network's outputs
+	 */
+	void Network::removeNeurons ( int index, std::vector<int> neurons )
+	{
+		if ( index < 0 || index + 1 >= this->size() )
+			throw std::out_of_range("Network::removeNeurons: only the layers before the output layer can be pruned");
+
+		Layer& layer = *this->layers[index];
+		Layer& next = *this->layers[index + 1];
+
+		std::vector<bool> keep( layer.nNeurons, true );
+		for (auto it = neurons.begin(); it != neurons.end(); ++it)
+		{
+			if ( *it < 0 || *it >= layer.nNeurons )
+				throw std::out_of_range("Network::removeNeurons: no such neuron");
+
+			keep[*it] = false;
+		}
+
+		const int remaining = std::count( keep.begin(), keep.end(), true );
+		if ( remaining == 0 )
+			throw std::invalid_argument("Network::removeNeurons: a layer needs at least one neuron");
+
+		// a pruned layer goes back to its dense kernel, since its sparse copy is about to go stale
+		layer.densify();
+		next.densify();
+
+		const std::vector<bool> allLayerCols( layer.nWeights, true );
+		const std::vector<bool> allNextRows( next.nNeurons, true );
+
+		sliceBlock( layer.weights, keep, allLayerCols );
+		sliceBlock( layer.moment1, keep, allLayerCols );
+		sliceBlock( layer.moment2, keep, allLayerCols );
+		sliceBlock( next.weights, allNextRows, keep );
+		sliceBlock( next.moment1, allNextRows, keep );
+		sliceBlock( next.moment2, allNextRows, keep );
+		layer.gradient.clear();
+		next.gradient.clear();
+
+		layer.nNeurons = remaining;
+		next.nWeights = remaining;
+
+		for (auto it = layer.neurons.begin(); it != layer.neurons.end(); ++it)
+			delete (*it);
+
+		layer.neurons = std::vector<Layer::Neuron *>( remaining );
+		for (auto it = layer.neurons.begin(); it != layer.neurons.end(); ++it)
+			(*it) = new Layer::Neuron( it - layer.neurons.begin(), layer );
+
+		layer.selectKernel();
+		next.selectKernel();
+
+		// the arena's slabs have moved, so rebuild it at its current batch size
+		int batch = this->arenaBatch;
+		this->arenaBatch = 0;
+		this->reserve( std::max( batch, 1 ) );
+
+		this->weightsChanged( false, std::vector<int>{ index, index + 1 } );
+	}
+
+	// mean squared error, accuracy and latency of the network over a calibration set
+	static Network::ShrinkReport evaluateShrink ( Network& net, int step, const std::vector<std::vector<double> >& inputs, const std::vector<std::vector<double> >& targets )
+	{
+		typedef std::chrono::steady_clock clock;
+
+		Network::ShrinkReport report;
+		report.step = step;
+		report.neurons = 0;
+		report.weights = 0;
+
+		for (auto layer = net.begin(); layer != net.end(); ++layer)
+		{
+			report.weights += (*layer).weights.size();
+			if ( (*layer).index + 1 < net.size() )
+				report.neurons += (*layer).size();
+		}
+
+		clock::time_point start = clock::now();
+		std::vector<std::vector<double> > outputs;
+		for (auto it = inputs.begin(); it != inputs.end(); ++it)
+			outputs.push_back( net.feedForward(*it) );
+		std::chrono::duration<double> elapsed = clock::now() - start;
+
+		double error = 0;
+		int correct = 0;
+		for (size_t s = 0; s < outputs.size(); ++s)
+		{
+			const std::vector<double>& out = outputs[s];
+			const std::vector<double>& target = targets[s];
+
+			for (size_t i = 0; i < out.size(); ++i)
+				error += ( out[i] - target[i] ) * ( out[i] - target[i] );
+
+			if ( out.size() == 1 )
+				correct += std::fabs( out[0] - target[0] ) < 0.5;
+			else
+				correct += std::max_element( out.begin(), out.end() ) - out.begin() == std::max_element( target.begin(), target.end() ) - target.begin();
+		}
+
+		const double n = std::max( (double)outputs.size(), 1.0 );
+		report.error = error / ( n * net.outputs() );
+		report.accuracy = correct / n;
+		report.seconds = elapsed.count() / n;
+
+		return report;
+	}
+
+	/**
+	 * iteratively remove the least important neurons from every layer but the output layer
+	 *
+	 * each of the 'steps' steps removes an equal share of 'fraction' of each layer's original neurons,
+	 * choosing the lowest scoring ones, and then measures the network on the calibration set
+	 *
+	 * :param fraction - fraction of the neurons of each layer to remove in total (each layer keeps at least one)
+	 * :param steps - number of pruning steps
+	 * :param inputs / targets - calibration set
+	 * :param score - how neurons are ranked
+	 * :return - a report before pruning, and after each step
+	 */
+	std::vector<Network::ShrinkReport> Network::shrink ( double fraction, int steps, const std::vector<std::vector<double> >& inputs, const std::vector<std::vector<double> >& targets, NeuronScore score )
+	{
+		if ( fraction < 0 || fraction >= 1 )
+			throw std::invalid_argument("Network::shrink: the fraction should be in [0, 1)");
+		if ( inputs.size() != targets.size() )
+			throw std::invalid_argument("Network::shrink: expected one target per calibration input");
+		if ( steps < 1 )
+			steps = 1;
+
+		// the training-mode forward pass would record activations we don't need; the caller's mode is
+		// put back afterwards, even if a step throws
+		const bool wasTraining = this->training;
+		this->training = false;
+
+		std::vector<ShrinkReport> reports;
+
+		try
+		{
+			std::vector<int> original;
+			for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+				original.push_back( (*it)->nNeurons );
+
+			reports.push_back( evaluateShrink( *this, 0, inputs, targets ) );
+
+			for (int step = 1; step <= steps; ++step)
+			{
+				// activation statistics are gathered once per step, over every layer at once
+				std::vector<std::vector<double> > activity;
+				if ( score == MeanActivation )
+				{
+					for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+						activity.push_back( std::vector<double>( (*it)->nNeurons, 0 ) );
+
+					for (auto sample = inputs.begin(); sample != inputs.end(); ++sample)
+					{
+						std::vector<double> feed = *sample;
+						for (size_t l = 0; l < this->layers.size(); ++l)
+						{
+							feed = this->layers[l]->feedForward(feed);
+							for (size_t i = 0; i < feed.size(); ++i)
+								activity[l][i] += std::fabs( feed[i] );
+						}
+					}
+				}
+
+				for (int l = 0; l + 1 < this->size(); ++l)
+				{
+					Layer& layer = *this->layers[l];
+					Layer& next = *this->layers[l + 1];
+
+					int target = std::max( 1, (int)std::ceil( original[l] * ( 1 - fraction * step / steps ) ) );
+					int remove = layer.nNeurons - target;
+					if ( remove <= 0 )
+						continue;
+
+					std::vector<double> scores( layer.nNeurons, 0 );
+					if ( score == MeanActivation )
+						scores = activity[l];
+					else
+					{
+						const double* row = next.weights.data();
+						for (int i = 0; i < next.nNeurons; ++i, row += next.nWeights)
+							for (int j = 0; j < next.nWeights; ++j)
+								scores[j] += row[j] * row[j];
+					}
+
+					std::vector<int> order( layer.nNeurons );
+					for (size_t i = 0; i < order.size(); ++i)
+						order[i] = i;
+
+					std::partial_sort( order.begin(), order.begin() + remove, order.end(), [&scores]( int a, int b ) {
+						return scores[a] < scores[b];
+					});
+
+					this->removeNeurons( l, std::vector<int>( order.begin(), order.begin() + remove ) );
+				}
+
+				reports.push_back( evaluateShrink( *this, step, inputs, targets ) );
+			}
+		}
+		catch ( ... )
+		{
+			this->training = wasTraining;
+			throw;
+		}
+
+		this->training = wasTraining;
+		return reports;
+	}
+}
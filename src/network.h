@@ -32,11 +32,22 @@
 #include <stdexcept>
 #include <iterator>
 #include <fstream>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+
+#include "numa.h"
 
 namespace machine {
 
 	// forward declare our classes
 	class Network;
+	class InferenceCache;
+	class Telemetry;
+	class Communicator;
+	class ThreadPool;
 	struct ActFunction;
 
 	/**
@@ -53,6 +64,9 @@ namespace machine {
 	extern ActFunction softplus;
 	extern ActFunction hyperbolic_tan;
 
+	// f(x) = x, for an output layer whose outputs are its sums (see Parameters::softmaxOutput)
+	extern ActFunction identity;
+
 	// define 'act' as a shared pointer to an activation function
 	typedef std::shared_ptr<std::function<double(double)> > act_handle;
 
@@ -64,12 +78,17 @@ namespace machine {
 
 	/**
 	 * ActFunction implements both the activation function (as dxdy) and it's first
-	 * derivative (as dydx)
+	 * derivative (as dydx); the derivative is written in terms of the function's output y,
+	 * which is what the backward pass has recorded
+	 *
+	 * the built in functions are also named, so that code generated for a specific activation
+	 * (see 'fixed.h') can check it matches the network it was built from
 	 */
 	struct ActFunction
 	{
 		act_handle _dxdy;
 		act_handle _dydx;
+		std::string name;
 
 		double dxdy ( double x ) const
 		{
@@ -100,10 +119,30 @@ namespace machine {
 	    return init_handle( new std::function<double()>(f) );
 	}
 
-	// the default initialization function returns random numbers
+	// returns random numbers from a single shared generator, one weight at a time
 	// defined in 'network.cpp'
 	extern init_handle random;
 
+	/**
+	 * scaled initializers map a uniform random number u in [0,1) to a weight of a layer with the
+	 * given fan-in (weights per neuron) and fan-out (neurons); the random numbers come from a
+	 * counter-based generator keyed on (seed, layer, row, column), so every weight can be drawn
+	 * independently and a whole layer is filled in parallel with the same result on any number of threads
+	 *
+	 * defined in 'network-fun.cpp'
+	 */
+	typedef double (*init_scale)( double, int, int );
+
+	extern init_scale uniform;	// u itself, in [0,1) (the default)
+	extern init_scale xavier;	// Glorot uniform, in +/- sqrt(6 / (fanIn + fanOut))
+	extern init_scale he;		// He uniform, in +/- sqrt(6 / fanIn)
+
+	/**
+	 * fill rows [lo, hi) of a (rows x cols) weight block of layer 'layer'
+	 * with scale( u(seed, layer, row, col), cols, rows )
+	 */
+	void initializeBlock ( double*, int, int, int, int, int, uint64_t, init_scale );
+
 	/**
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	 * 			Propogation functions
@@ -125,6 +164,9 @@ namespace machine {
 	// the default propogation function is the dot product of the input vector and the neuron's weight vector
 	extern prop_handle dotprod;
 
+	// dot product of two arrays of length n; layers using 'dotprod' call this directly on their weight block
+	double dot ( const double*, const double*, size_t );
+
 	/**
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	 * 			Training functions
@@ -148,6 +190,33 @@ namespace machine {
 	// the default training function
 	extern train_handle backPropogation;
 
+	// back propogation with adaptive update rules, see 'Optimizers' in 'network-fun.cpp'
+	// the hyperparameters are set with Parameters::momentum, Parameters::decay and Parameters::epsilon
+	extern train_handle momentum;
+	extern train_handle nesterov;
+	extern train_handle rmsprop;
+	extern train_handle adam;
+
+
+	// a sparse input vector, as (index, value) pairs of its nonzero elements
+	typedef std::vector<std::pair<int, double> > sparse_vector;
+
+	/**
+	 * a non-owning, read-only view of a run of doubles, such as the activations a layer recorded
+	 * in the network's arena during training. The view is only valid until the next training step;
+	 * convert it to a std::vector to keep a copy.
+	 */
+	struct ActivationView
+	{
+		const double* ptr;
+		size_t n;
+
+		const double* begin () const { return ptr; }
+		const double* end () const { return ptr + n; }
+		size_t size () const { return n; }
+		const double& operator[] ( size_t i ) const { return ptr[i]; }
+		operator std::vector<double> () const { return std::vector<double>( ptr, ptr + n ); }
+	};
 
 	/**
 	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -182,14 +251,14 @@ namespace machine {
 			 *					Neuron
 			 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 			 *
-			 * right now, this could probably just be a vector within Layer, instead of a seperate class
-			 * but we'll probably need it to be its own class later on when we get to more complicated networks
-			 * so it exists for now.
+			 * a Neuron is a view of one row of its Layer's weight block; the weights of a layer are stored
+			 * contiguously (row-major, one row per neuron) so that the propogation and update kernels can
+			 * stream over them in a single pass.
 			 */
 			class Neuron
 			{
 			public:
-				Neuron ( int, Network& );
+				Neuron ( int, Layer& );
 				~Neuron();
 				std::vector<double>::iterator begin();
 				std::vector<double>::iterator end();
@@ -197,9 +266,8 @@ namespace machine {
 			private:
 				friend class Network;
 				friend class Layer;
-				Network &parent;
-				int nWeights;
-				std::vector<double> weights;
+				Layer &layer;
+				int index;
 			};
 
 			/**
@@ -242,15 +310,97 @@ namespace machine {
 			 * :param nWeights - length of the layer; eg. dimension of the weight vector of each of n 'neurons'
 			 */
 			Layer ( int, int, Network&, int );
+			Layer ( const Layer&, Network& );
 			~Layer();
-			std::vector<double> getInput();
-			std::vector<double> getOutput();
+			double* data();
+			ActivationView getInput( int = 0 ) const;
+			ActivationView getOutput( int = 0 ) const;
 			std::vector<double> feedForward( std::vector<double> );
+			void forward( const double*, double*, int ) const;
+			void forward32( const float*, float*, int ) const;
+			const float* floats();
+			void selectKernel();
+			void sparsify();
+			void densify();
+			void refreshSparse();
+			int nonzeros() const;
+			const double* columns();
 			Layer::iterator begin();
 			Layer::iterator end();
 			int size() const;
 			int index;
 
+			// row-major weight block (nNeurons x nWeights), and the gradient of the most recent training step
+			std::vector<double> weights;
+			std::vector<double> gradient;
+
+			// per-weight optimizer state, parallel to the weight block, allocated by the optimizers that need it
+			std::vector<double> moment1;
+			std::vector<double> moment2;
+			unsigned long updates;
+
+			/**
+			 * the propogation kernel, chosen from the shape of the layer by selectKernel
+			 *
+			 * :MatVec - one dot product per neuron and sample; for small layers, where blocking buys nothing
+			 * :Blocked - tiles the weight block so that each tile stays in cache while it's applied to
+			 * 		groups of 4 samples at once (a register-blocked GEMM)
+			 * :Parallel - the blocked kernel, with the rows split across the thread pool
+			 * :Generic - calls a user supplied propogation function through its handle
+			 * :Sparse - multiplies by the compressed sparse row copy of the weights, after pruning
+			 *
+			 * every kernel sums each dot product in the same order, so they produce identical results
+			 * (the sparse kernel just leaves out the zero terms)
+			 */
+			enum Kernel { MatVec, Blocked, Parallel, Generic, Sparse };
+			Kernel kernel;
+
+			// compressed sparse row copy of the weight block, built by sparsify; row i's nonzeros are
+			// sparseValues[ sparseRows[i] .. sparseRows[i+1] ), in columns sparseColumns[ ... ]
+			std::vector<int> sparseRows;
+			std::vector<int> sparseColumns;
+			std::vector<double> sparseValues;
+
+			// column-major (nWeights x nNeurons) copy of the weight block, rebuilt by 'columns' whenever the
+			// network's version has moved on; column j holds the weights every neuron applies to input j
+			std::vector<double> transposed;
+			std::atomic<unsigned long long> transposedVersion;
+			std::mutex transposedMutex;
+
+			/**
+			 * NUMA placement (see Parameters::numa): the rows node i works on are nodeRows[i] to nodeRows[i+1],
+			 * and are bound to that node; when there's more than one node, inference reads a full copy of
+			 * the weights on the reader's own node, rebuilt by 'replica' whenever the version moves on
+			 */
+			std::vector<int> nodeRows;
+			const double* boundWeights;
+			mutable std::vector<NodeBuffer> replicas;
+			mutable std::atomic<unsigned long long> replicaVersion;
+			mutable std::mutex replicaMutex;
+			const double* replica( int ) const;
+
+			/**
+			 * fn(lo, hi) over ranges of the rows, or of the weight block, by node once the layer is placed;
+			 * fn is only ever passed on by reference, so a training step doesn't allocate for it
+			 */
+			template <class F>
+			void forRows( const F& fn ) const
+			{
+				if ( this->nodeRows.empty() )
+					fn( 0, this->nNeurons );
+				else
+					this->forRowsOnNodes( std::cref(fn) );
+			}
+
+			template <class F>
+			void forWeights( const F& fn ) const
+			{
+				const size_t cols = this->nWeights;
+				this->forRows( [&fn, cols]( int lo, int hi ) {
+					fn( lo * cols, hi * cols );
+				});
+			}
+
 			// stream operators for serializing the layer
 			friend std::ostream& operator<<( std::ostream&, const Layer& );
 			friend std::istream& operator>>( std::istream&, Layer& );
@@ -261,8 +411,17 @@ namespace machine {
 			int nNeurons;
 			int nWeights;
 			std::vector<Layer::Neuron *> neurons;
-			std::vector<double> input;	
-			std::vector<double> output;	
+			void numaForward( const double*, double*, int ) const;
+			void forRowsOnNodes( const std::function<void(int, int)>& ) const;
+
+			// float32 copy of the weight block for mixed precision training, rebuilt by 'floats' when the version moves on
+			std::vector<float> weights32;
+			unsigned long long weights32Version;
+
+			// views of this layer's (batch x nWeights) input and (batch x nNeurons) output slabs in the
+			// network's activation arena; the input slab is the previous layer's output slab
+			const double* input;
+			double* output;
 		
 		}; // end class Layer
 
@@ -277,9 +436,38 @@ namespace machine {
 		 * :param nOutputs - size of the output vector
 		 * :param nHiddenLayers - number of hidden layers
 		 * :param hiddenSize - size of each hidden layer (default is the floor of the mean of the input and output layer's size)
+		 * :param layerSizes - explicit topology, as the size of the input vector followed by the width of each layer;
+		 * 		eg. {784, 512, 128, 10} builds 3 layers of 512, 128 and 10 neurons. When set, this takes the place
+		 * 		of inputs, outputs, hiddenLayers and hiddenSize, and no square input layer is added.
 		 * :param actf - activation function (default is the sigmoid function)
-		 * :param initf - initialization function (default is random)
+		 * :param initf - initialization function; either a scaled initializer (default is uniform), or an
+		 * 		init_handle called once per weight, in order (eg. random)
+		 * :param seed - seed of the scaled initializers; networks built with the same seed and topology get
+		 * 		the same weights (default is a seed from std::random_device, see Network::seed)
 		 * :param trainf - training function (default is backPropogation)
+		 * :param momentum - momentum of the 'momentum' and 'nesterov' optimizers, and beta1 of 'adam' (default is 0.9)
+		 * :param decay - decay of the squared gradient average of 'rmsprop', and beta2 of 'adam' (default is 0.999)
+		 * :param epsilon - term added to the denominator of 'rmsprop' and 'adam' (default is 1e-8)
+		 * :param batchSize - number of samples per training step the activation arena is allocated for up front (default is 1)
+		 * :param memoryBudget - most bytes the activation arena should take; when keeping every layer's activations
+		 * 		would take more, only every k-th layer's are kept and the rest are recomputed in the backward pass, with k
+		 * 		the smallest interval that fits (default is 0, for no limit)
+		 * :param checkpointInterval - keep the activations of every k-th layer, whatever the budget (default is 0, to
+		 * 		choose k from memoryBudget)
+		 * :param mixedPrecision - train with float32 activations, errors and weight copies, updating double master
+		 * 		weights (default is false)
+		 * :param lossScale - starting factor the error is scaled by in mixed precision, so that small gradients don't
+		 * 		flush to zero; it's halved whenever a step overflows and doubled after a run of clean steps (default is 1)
+		 * :param cacheSize - capacity in bytes of the feedForward result cache (default is 0, which disables the cache)
+		 * :param telemetry - file every training step is recorded to, as newline-delimited JSON (or CSV, if the name
+		 * 		ends in '.csv'), by a background thread; see 'telemetry.h' (default is empty, for no telemetry)
+		 * :param numa - give the network a pool of its own, with its workers pinned across the machine's NUMA nodes, split
+		 * 		the rows of the layers that use the Parallel kernel between the nodes for the forward pass, the gradient and
+		 * 		the update, and give each node its own copy for inference (default is false)
+		 * :param softmaxOutput - treat the outputs as the scores of a softmax classifier (see 'classifier.h'): the output
+		 * 		layer has no activation function, so it outputs its sums (the logits), and training minimizes the softmax
+		 * 		cross-entropy against 'expected', as target probabilities such as a one-hot label, instead of the squared
+		 * 		error (default is false)
 		 */
 		class Parameters
 		{
@@ -290,10 +478,26 @@ namespace machine {
 			unsigned int __outputs;
 			unsigned int __hiddenLayers;
 			unsigned int __hiddenSize;
+			std::vector<unsigned int> __layerSizes;
 			bool __biasTerm;
 			double __rate;
+			double __momentum;
+			double __decay;
+			double __epsilon;
+			unsigned int __batchSize;
+			size_t __memoryBudget;
+			unsigned int __checkpointInterval;
+			bool __mixedPrecision;
+			double __lossScale;
+			size_t __cacheSize;
+			std::string __telemetry;
+			bool __numa;
+			bool __softmaxOutput;
 			ActFunction actf;
 			init_handle initf;
+			init_scale inits;
+			uint64_t __seed;
+			bool __seeded;
 			prop_handle propf;
 			train_handle trainf;
 
@@ -304,10 +508,25 @@ namespace machine {
 			Parameters& outputs ( int );
 			Parameters& hiddenLayers ( int );
 			Parameters& hiddenSize ( int );
+			Parameters& layerSizes ( std::vector<unsigned int> );
 			Parameters& rate ( double );
+			Parameters& momentum ( double );
+			Parameters& decay ( double );
+			Parameters& epsilon ( double );
+			Parameters& batchSize ( int );
+			Parameters& memoryBudget ( size_t );
+			Parameters& checkpointInterval ( int );
+			Parameters& mixedPrecision ( bool );
+			Parameters& lossScale ( double );
 			Parameters& biasTerm ( bool );
+			Parameters& cacheSize ( size_t );
+			Parameters& telemetry ( std::string );
+			Parameters& numa ( bool );
+			Parameters& softmaxOutput ( bool );
 			Parameters& activation ( ActFunction );
 			Parameters& initialization ( init_handle );
+			Parameters& initialization ( init_scale );
+			Parameters& seed ( uint64_t );
 			Parameters& propogation ( prop_handle );
 			Parameters& training ( train_handle );
 
@@ -367,20 +586,204 @@ namespace machine {
 		// 	pointer ptr_;
 		// };
 
+		/**
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 * 				Prune Report
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 *
+		 * what magnitude pruning did to one layer, and what it bought
+		 *
+		 * :param layer - index of the layer
+		 * :param weights - size of the weight block
+		 * :param nonzeros - weights left after pruning
+		 * :param denseSeconds / sparseSeconds - measured time of one feedForward through the layer with each kernel
+		 * :param speedup - denseSeconds / sparseSeconds
+		 * :param converted - whether the layer now uses the sparse kernel (only when it's actually faster); a converted
+		 * 		layer stays pruned through training, with the weights it was pruned of held at zero, and through the
+		 * 		pruning of other layers
+		 */
+		struct PruneReport
+		{
+			int layer;
+			int weights;
+			int nonzeros;
+			double sparsity;
+			double denseSeconds;
+			double sparseSeconds;
+			double speedup;
+			bool converted;
+		};
+
+		/**
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 * 				Shrink Report
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 *
+		 * the state of the network after one step of structured pruning (step 0 is before any pruning)
+		 *
+		 * :param neurons - total number of neurons in the layers that can be pruned (all but the output layer)
+		 * :param weights - total number of weights in the network
+		 * :param error - mean squared error over the calibration set
+		 * :param accuracy - fraction of the calibration set whose largest output matches the target's
+		 * 		(or, with a single output, is within 0.5 of it)
+		 * :param seconds - mean time of one feedForward
+		 */
+		struct ShrinkReport
+		{
+			int step;
+			int neurons;
+			int weights;
+			double error;
+			double accuracy;
+			double seconds;
+		};
+
+		/**
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 * 				Metrics
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 *
+		 * how the network scores on a labelled dataset (see Network::evaluate)
+		 *
+		 * the class of an output or a target is the index of its largest element; with a single output
+		 * there are two classes, below and above 0.5
+		 *
+		 * the scores follow the kind of outputs: for a network built with Parameters::softmaxOutput (and more
+		 * than one output) they're taken on the probabilities softmax gives the logits, and otherwise on the
+		 * outputs themselves, as probabilities in [0,1]
+		 *
+		 * :param mse - squared error of the probabilities, averaged over the samples and the outputs
+		 * :param crossEntropy - mean over the samples of the softmax cross-entropy of the logits against the
+		 * 		target probabilities, or otherwise of the binary cross-entropy of each output against its
+		 * 		target, summed over the outputs
+		 * :param accuracy - fraction of the samples whose class matches the target's
+		 * :param confusion - confusion[t][p] is the number of samples of target class t predicted as class p
+		 * :param seconds - wall time of the evaluation
+		 */
+		struct Metrics
+		{
+			int samples;
+			double mse;
+			double crossEntropy;
+			double accuracy;
+			std::vector<std::vector<long> > confusion;
+			double seconds;
+		};
+
+		/**
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 * 				Memory Usage
+		 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+		 *
+		 * bytes held by a network (see Network::memory), or that one would hold (see Network::estimate)
+		 *
+		 * :param weights - the weight block
+		 * :param gradient - the gradient of the last training step
+		 * :param optimizer - per-weight state of the optimizer ('moment1' and 'moment2')
+		 * :param copies - copies of the weights made for other kernels: the sparse, transposed, float32 and per-node copies
+		 * :param activations - the slab of the activation arena kept for the backward pass (a layer's output, or
+		 * 		for the whole network, the outputs of the checkpoints and the input), with its float32 twin
+		 * :param scratch - the rest of the arena: the workspace shared between checkpoints and the two error buffers
+		 * :param cache - the feedForward result cache
+		 */
+		struct LayerMemory
+		{
+			int layer;
+			size_t weights;
+			size_t gradient;
+			size_t optimizer;
+			size_t copies;
+			size_t activations;
+			size_t total;
+		};
+
+		struct MemoryUsage
+		{
+			std::vector<LayerMemory> layers;
+			size_t weights;
+			size_t gradient;
+			size_t optimizer;
+			size_t copies;
+			size_t activations;
+			size_t scratch;
+			size_t cache;
+			size_t total;
+		};
+
+		// how shrink decides which neurons matter least
+		enum NeuronScore
+		{
+			OutgoingWeightNorm,		// L2 norm of the neuron's column in the next layer's weights
+			MeanActivation			// mean absolute output of the neuron over the calibration set
+		};
+
 		Network ( const Parameters* );
 		~Network();
 
+		// a copy of the network's current weights (and sparse kernels) to serve inference from, see ModelHolder
+		Network* snapshot () const;
+
 		std::vector<double> feedForward ( std::vector<double> );
+		std::vector<std::vector<double> > feedForward ( const std::vector<std::vector<double> >& );
+		std::vector<double> feedForwardSparse ( const sparse_vector& );
 		std::vector<double> train ( std::vector<double>, std::vector<double> );
+		void forward ( const double*, int );
+		void restore ( int );
+		double* errorBuffer ( int );
+		float* shadow ( const double* );
+		bool mixedPrecision () const;
+		bool softmaxOutput () const;
+		double lossScale () const;
+		bool scaleLoss ( bool );
+		int checkpointInterval () const;
+		size_t activationBytes () const;
 		void toggleTrainingMode();
+		bool trainingMode () const;
 		double propogate ( std::vector<double>, std::vector<double> );
 		const ActFunction& activate ();
+		const ActFunction& activate ( int );
 		double init ();
 		int size () const;
+		int inputs () const;
+		int outputs () const;
 		double rate () const;
+		double momentum () const;
+		double decay () const;
+		double epsilon () const;
+		unsigned long long version () const;
+		uint64_t seed () const;
+		InferenceCache* cache ();
+		Telemetry* telemetry ();
 		void save ( std::string );
 		void load ( std::string );
 
+		// magnitude pruning, see 'network-prune.cpp'
+		std::vector<PruneReport> prune ( double, std::vector<int> = std::vector<int>() );
+		std::vector<PruneReport> pruneToSparsity ( double, std::vector<int> = std::vector<int>() );
+
+		// structured pruning, see 'network-prune.cpp'
+		void removeNeurons ( int, std::vector<int> );
+		std::vector<ShrinkReport> shrink ( double, int, const std::vector<std::vector<double> >&, const std::vector<std::vector<double> >&, NeuronScore = OutgoingWeightNorm );
+
+		// where the threads and weights were put when Parameters::numa is set, see 'network-numa.cpp'
+		const NumaPlacement& placement () const;
+
+		// data-parallel training over a group of processes, see 'network-distributed.cpp'
+		void distribute ( Communicator* );
+		Communicator* communicator () const;
+		void averageGradient ( Layer& );
+
+		// scoring a dataset on the thread pool, see 'network-evaluate.cpp'
+		Metrics evaluate ( const std::vector<std::vector<double> >&, const std::vector<std::vector<double> >&, int = 64 );
+
+		// memory accounting, see 'network-memory.cpp'
+		MemoryUsage memory () const;
+		static MemoryUsage estimate ( const Parameters&, int = 0 );
+
+		// C++ source export, see 'network-export.cpp'
+		void exportHeader ( std::string, std::string );
+		void exportHeader ( std::ostream&, std::string );
+
 		// stream operators
 		friend std::ostream& operator<<( std::ostream&, const Network& );
 		friend std::istream& operator>>( std::istream&, Network& );
@@ -394,11 +797,67 @@ namespace machine {
 	private:
 		friend class Layer;
 		friend class Trainer;
+
+		Network ( const Network& );
+		Network& operator= ( const Network& );
 		
 		const Parameters* params;
 		std::vector<Layer*> layers;
 		bool training;
 
+		// all of the activations recorded in training mode live in one preallocated block:
+		// the (batch x inputs) input slab, one (batch x width) output slab per layer, and two
+		// (batch x widest layer) error buffers for the backward pass
+		//
+		// with checkpointing, only every k-th layer (and the last) has a slab of its own; the layers
+		// between two checkpoints share a workspace, which holds one segment at a time
+		std::vector<double> arena;
+		int arenaBatch;
+		double* errors[2];
+		int checkpointEvery;
+		int forwardBatch;
+		int restoredSegment;
+
+		// in mixed precision, a float32 twin of the arena with the same layout, and the dynamic loss scale
+		std::vector<float> arena32;
+		double currentLossScale;
+		int cleanSteps;
+
+		// set by scaleLoss when it holds back the step in progress, so that 'train' knows the weights didn't move
+		bool skippedStep;
+
+		void reserve ( int );
+		std::vector<int> widths () const;
+		static std::vector<std::pair<int, int> > topology ( const Parameters& );
+		static bool isCheckpoint ( int, int, int );
+		static int checkpointInterval ( const std::vector<int>&, int, int, const Parameters& );
+		static size_t arenaSize ( const std::vector<int>&, int, int, int );
+
+		// seed the weights were initialized from
+		uint64_t initSeed;
+
+		// bumped every time the weights change, so that results cached against the old weights are never reused
+		std::atomic<unsigned long long> modelVersion;
+		std::unique_ptr<InferenceCache> resultCache;
+
+		// per-step training records, when Parameters::telemetry is set
+		std::unique_ptr<Telemetry> monitor;
+		unsigned long long trainSteps;
+		std::vector<double> stepTarget;
+		void recordStep ( const std::vector<double>&, const std::vector<double>&, int, double );
+
+		NumaPlacement numaPlacement;
+		// the pool the NUMA kernels run on, pinned across the nodes; shared with the network's snapshots,
+		// so that the process-wide pool's workers are never pinned
+		std::shared_ptr<ThreadPool> nodePool;
+
+		// the processes training copies of this network, when it's distributed
+		Communicator* group;
+
+		void weightsChanged ( bool = false, const std::vector<int>& = std::vector<int>() );
+		void placeOnNodes ();
+		std::vector<PruneReport> convertToSparse ( const std::vector<int>& );
+
 	}; // end class Network
 }
 
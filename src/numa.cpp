@@ -0,0 +1,276 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <new>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "numa.h"
+
+namespace machine {
+
+	// parse a sysfs cpu or node list, eg. "0-3,8-11"
+	static std::vector<int> parseList ( const std::string& list )
+	{
+		std::vector<int> result;
+		std::stringstream ss(list);
+		std::string range;
+
+		while ( std::getline( ss, range, ',' ) )
+		{
+			if ( range.empty() || range[0] < '0' || range[0] > '9' )
+				continue;
+
+			size_t dash = range.find('-');
+			int lo = std::atoi( range.c_str() );
+			int hi = dash == std::string::npos ? lo : std::atoi( range.c_str() + dash + 1 );
+
+			for (int i = lo; i <= hi; ++i)
+				result.push_back(i);
+		}
+
+		return result;
+	}
+
+	static std::string readLine ( const std::string& path )
+	{
+		std::ifstream in( path );
+		std::string line;
+		std::getline( in, line );
+		return line;
+	}
+
+	NumaTopology::NumaTopology ()
+	{
+#ifdef __linux__
+		std::vector<int> online = parseList( readLine("/sys/devices/system/node/online") );
+
+		for (auto it = online.begin(); it != online.end(); ++it)
+		{
+			std::vector<int> cpus = parseList( readLine( "/sys/devices/system/node/node" + std::to_string(*it) + "/cpulist" ) );
+
+			// memory-only nodes have no cpus to run workers on
+			if ( cpus.empty() )
+				continue;
+
+			// nodes are renumbered densely, in case the kernel's numbering has gaps
+			for (auto cpu = cpus.begin(); cpu != cpus.end(); ++cpu)
+			{
+				if ( *cpu >= (int)this->cpuNode.size() )
+					this->cpuNode.resize( *cpu + 1, 0 );
+
+				this->cpuNode[*cpu] = this->nodeCpus.size();
+			}
+
+			this->nodeCpus.push_back(cpus);
+			this->nodeIds.push_back(*it);
+		}
+#endif
+
+		if ( this->nodeCpus.empty() )
+		{
+			this->cpuNode.clear();
+			std::vector<int> all;
+
+			for (unsigned int i = 0; i < std::max( 1u, std::thread::hardware_concurrency() ); ++i)
+			{
+				all.push_back(i);
+				this->cpuNode.push_back(0);
+			}
+
+			this->nodeCpus.push_back(all);
+			this->nodeIds.assign( 1, 0 );
+		}
+	}
+
+	const NumaTopology& NumaTopology::system ()
+	{
+		static NumaTopology topology;
+		return topology;
+	}
+
+	int NumaTopology::nodes () const
+	{
+		return this->nodeCpus.size();
+	}
+
+	const std::vector<int>& NumaTopology::cpus ( int node ) const
+	{
+		return this->nodeCpus[node];
+	}
+
+	int NumaTopology::nodeOf ( int cpu ) const
+	{
+		return cpu >= 0 && cpu < (int)this->cpuNode.size() ? this->cpuNode[cpu] : 0;
+	}
+
+	int NumaTopology::currentNode () const
+	{
+		if ( this->nodeCpus.size() == 1 )
+			return 0;
+
+#ifdef __linux__
+		return this->nodeOf( sched_getcpu() );
+#else
+		return 0;
+#endif
+	}
+
+	bool NumaTopology::bind ( void* addr, size_t bytes, int node ) const
+	{
+#if defined(__linux__) && defined(SYS_mbind)
+		// only a single node: nothing to do, and nothing to report as a failure either
+		if ( this->nodeCpus.size() == 1 )
+			return true;
+
+		// values from <linux/mempolicy.h>
+		static const int policyBind = 2;
+		static const unsigned int moveExisting = 1 << 1;
+
+		const size_t page = sysconf(_SC_PAGESIZE);
+		size_t lo = ( (size_t)addr + page - 1 ) / page * page;
+		size_t hi = ( (size_t)addr + bytes ) / page * page;
+
+		if ( hi <= lo )
+			return true;
+
+		unsigned long mask[ 1024 / ( 8 * sizeof(unsigned long) ) ] = {};
+		const int id = this->nodeIds[node];
+		mask[ id / ( 8 * sizeof(unsigned long) ) ] |= 1ul << ( id % ( 8 * sizeof(unsigned long) ) );
+
+		return syscall( SYS_mbind, lo, hi - lo, policyBind, mask, 1024, moveExisting ) == 0;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 				NodeBuffer
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 */
+
+	NodeBuffer::NodeBuffer () : ptr(nullptr), n(0), bytes(0), home(0) {}
+
+	NodeBuffer::NodeBuffer ( size_t n, int node ) : ptr(nullptr), n(n), bytes( n * sizeof(double) ), home(node)
+	{
+		if ( !this->bytes )
+			return;
+
+#ifdef __linux__
+		// mmap'd pages aren't backed until they're first written, so binding them first decides where they go
+		void* p = mmap( nullptr, this->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( p == MAP_FAILED )
+			throw std::bad_alloc();
+
+		NumaTopology::system().bind( p, this->bytes, node );
+		this->ptr = static_cast<double*>(p);
+#else
+		this->ptr = new double[n];
+#endif
+	}
+
+	NodeBuffer::NodeBuffer ( NodeBuffer&& other ) : ptr(other.ptr), n(other.n), bytes(other.bytes), home(other.home)
+	{
+		other.ptr = nullptr;
+		other.n = other.bytes = 0;
+	}
+
+	NodeBuffer& NodeBuffer::operator= ( NodeBuffer&& other )
+	{
+		if ( this != &other )
+		{
+			this->release();
+			this->ptr = other.ptr;
+			this->n = other.n;
+			this->bytes = other.bytes;
+			this->home = other.home;
+			other.ptr = nullptr;
+			other.n = other.bytes = 0;
+		}
+
+		return *this;
+	}
+
+	NodeBuffer::~NodeBuffer ()
+	{
+		this->release();
+	}
+
+	void NodeBuffer::release ()
+	{
+		if ( !this->ptr )
+			return;
+
+#ifdef __linux__
+		munmap( this->ptr, this->bytes );
+#else
+		delete[] this->ptr;
+#endif
+		this->ptr = nullptr;
+	}
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 				NumaPlacement
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 */
+
+	std::string NumaPlacement::describe () const
+	{
+		std::stringstream ss;
+
+		if ( !this->enabled )
+			return "numa: disabled\n";
+
+		ss << "numa: " << this->cpus.size() << " node(s), " << this->workerCpu.size() << " pool worker(s)"
+		   << ( this->bound ? "" : ", memory binding unavailable" ) << "\n";
+
+		for (size_t node = 0; node < this->cpus.size(); ++node)
+		{
+			ss << "  node " << node << ": " << this->cpus[node].size() << " cpu(s), workers on cpus";
+
+			for (size_t w = 0; w < this->workerCpu.size(); ++w)
+				if ( this->workerNode[w] == (int)node )
+					ss << " " << this->workerCpu[w];
+
+			ss << "\n";
+		}
+
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+		{
+			ss << "  layer " << it->layer << ": rows";
+
+			for (size_t node = 0; node + 1 < it->firstRow.size(); ++node)
+				ss << " [" << it->firstRow[node] << ", " << it->firstRow[node + 1] << ") on node " << node << ( node + 2 < it->firstRow.size() ? "," : "" );
+
+			if ( it->replicated )
+				ss << "; replicated for inference (" << it->replicaBytes << " bytes per node)";
+
+			ss << "\n";
+		}
+
+		return ss.str();
+	}
+}
@@ -0,0 +1,129 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace machine {
+
+	// the most nodes placement spreads a network over
+	static const int maxNumaNodes = 64;
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									NUMA Topology
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * the memory nodes of the machine and the cpus attached to each, as listed under
+	 * /sys/devices/system/node
+	 *
+	 * placement uses the mbind and affinity system calls directly, so there's no
+	 * dependency on libnuma. Anywhere else than Linux (or on a machine without NUMA support) the
+	 * topology is a single node holding every cpu, and binding memory is a no-op.
+	 *
+	 */
+	class NumaTopology
+	{
+	public:
+
+		// the topology of this machine, detected the first time it's asked for
+		static const NumaTopology& system ();
+
+		int nodes () const;
+		const std::vector<int>& cpus ( int ) const;
+
+		// node of a cpu, or of the cpu the calling thread is running on
+		int nodeOf ( int ) const;
+		int currentNode () const;
+
+		// move the pages wholly inside [addr, addr + bytes) to a node; false if that isn't supported
+		bool bind ( void*, size_t, int ) const;
+
+	private:
+
+		NumaTopology ();
+
+		std::vector<std::vector<int> > nodeCpus;
+		std::vector<int> nodeIds;	// the kernel's number for each node
+		std::vector<int> cpuNode;
+	};
+
+	/**
+	 * page aligned memory allocated on one node
+	 *
+	 * the pages are bound to the node before anything touches them, so they are placed there
+	 * whichever thread allocates or fills the buffer
+	 */
+	class NodeBuffer
+	{
+	public:
+
+		NodeBuffer ();
+		NodeBuffer ( size_t, int );
+		NodeBuffer ( NodeBuffer&& );
+		NodeBuffer& operator= ( NodeBuffer&& );
+		~NodeBuffer ();
+
+		double* data () const { return this->ptr; }
+		size_t size () const { return this->n; }
+		int node () const { return this->home; }
+
+	private:
+
+		NodeBuffer ( const NodeBuffer& );
+		NodeBuffer& operator= ( const NodeBuffer& );
+
+		void release ();
+
+		double* ptr;
+		size_t n;
+		size_t bytes;
+		int home;
+	};
+
+	/**
+	 * where a Network with Parameters::numa put its threads and weights
+	 *
+	 * inference reads a full replica of each large layer from the reader's own node; training
+	 * updates a single copy whose rows are split between the nodes, and each node's threads
+	 * work on their own rows first
+	 */
+	struct NumaPlacement
+	{
+		struct LayerPlacement
+		{
+			int layer;
+			bool replicated;				// has per-node replicas for inference
+			std::vector<int> firstRow;		// the rows of node i are firstRow[i] to firstRow[i+1]
+			size_t replicaBytes;			// bytes of each replica
+		};
+
+		bool enabled;
+		bool bound;							// the kernel accepted the mbind calls
+		std::vector<std::vector<int> > cpus;	// cpus of each node
+		std::vector<int> workerCpu;			// cpu each pool worker is pinned to, or -1
+		std::vector<int> workerNode;		// node of each pool worker
+		std::vector<LayerPlacement> layers;
+
+		NumaPlacement () : enabled(false), bound(false) {}
+
+		// a human readable summary, one line per node and per layer
+		std::string describe () const;
+	};
+}
+
+#endif
@@ -0,0 +1,364 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "numa.h"
+#include "pipeline.h"
+#include "trace.h"
+
+namespace machine {
+
+	/**
+	 * :param net - the network to run
+	 * :param stages - number of stages; 0 for one per cpu (at most one per layer)
+	 * :param depth - most samples in the pipeline at once
+	 */
+	LayerPipeline::LayerPipeline ( Network& net, int stages, size_t depth )
+		: net(net), depth( std::max( depth, (size_t)1 ) ), widest( net.inputs() ), stopping(false), pushed(0), popped(0)
+	{
+		for (auto it = net.begin(); it != net.end(); ++it)
+		{
+			this->layers.push_back( &*it );
+			this->widest = std::max( this->widest, (size_t)it->size() );
+		}
+
+		if ( stages <= 0 )
+			stages = std::max( std::thread::hardware_concurrency(), 1u );
+
+		this->count = std::min( stages, (int)this->layers.size() );
+		this->inputs.resize( this->depth * net.inputs() );
+
+		this->divide( this->probe() );
+		this->start();
+	}
+
+	LayerPipeline::~LayerPipeline()
+	{
+		this->stop();
+	}
+
+	bool LayerPipeline::push ( const std::vector<double>& input )
+	{
+		if ( (int)input.size() != this->net.inputs() )
+			throw std::invalid_argument("LayerPipeline: expected " + std::to_string( this->net.inputs() ) + " inputs");
+
+		if ( this->pushed - this->popped >= this->depth )
+			return false;
+
+		// the slot's last sample has been popped, so no stage is still reading it
+		const size_t slot = this->pushed % this->depth;
+		std::copy( input.begin(), input.end(), this->inputs.begin() + slot * input.size() );
+
+		this->rings.front()->push(slot);
+		++this->pushed;
+		return true;
+	}
+
+	bool LayerPipeline::pop ( std::vector<double>& output )
+	{
+		size_t slot;
+		if ( !this->rings.back()->pop(slot) )
+			return false;
+
+		const Worker& last = *this->workers.back();
+		const int width = this->layers.back()->size();
+
+		output.assign( last.output.begin() + slot * width, last.output.begin() + ( slot + 1 ) * width );
+		++this->popped;
+		return true;
+	}
+
+	std::vector<std::vector<double> > LayerPipeline::run ( const std::vector<std::vector<double> >& inputs )
+	{
+		if ( this->inFlight() != 0 )
+			throw std::logic_error("LayerPipeline: pop the samples already in flight before running a stream");
+
+		std::vector<std::vector<double> > outputs( inputs.size() );
+		size_t next = 0, done = 0;
+
+		while ( done < inputs.size() )
+		{
+			bool moved = false;
+
+			while ( next < inputs.size() && this->push( inputs[next] ) )
+			{
+				++next;
+				moved = true;
+			}
+
+			while ( done < next && this->pop( outputs[done] ) )
+			{
+				++done;
+				moved = true;
+			}
+
+			if ( !moved )
+				std::this_thread::yield();
+		}
+
+		return outputs;
+	}
+
+	void LayerPipeline::rebalance ()
+	{
+		if ( this->inFlight() != 0 )
+			throw std::logic_error("LayerPipeline: can't rebalance with samples in flight");
+
+		this->stop();
+
+		// a layer that hasn't seen a sample yet keeps the cost it was probed at
+		for (auto it = this->workers.begin(); it != this->workers.end(); ++it)
+		{
+			const Worker& worker = **it;
+			const unsigned long long samples = worker.samples.load();
+
+			if ( samples == 0 )
+				continue;
+
+			for (int l = worker.first; l <= worker.last; ++l)
+				this->cost[l] = worker.timed[ l - worker.first ] * 1e-9 / samples;
+		}
+
+		this->divide( this->cost );
+		this->start();
+	}
+
+	std::vector<LayerPipeline::Stage> LayerPipeline::stages () const
+	{
+		const double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - this->started ).count();
+		std::vector<Stage> result;
+
+		for (auto it = this->workers.begin(); it != this->workers.end(); ++it)
+		{
+			const Worker& worker = **it;
+			Stage stage;
+
+			stage.first = worker.first;
+			stage.last = worker.last;
+			stage.cpu = worker.cpu;
+			stage.cost = 0;
+			for (int l = worker.first; l <= worker.last; ++l)
+				stage.cost += this->cost[l];
+
+			stage.samples = worker.samples.load( std::memory_order_relaxed );
+			stage.busy = worker.busy.load( std::memory_order_relaxed ) * 1e-9;
+			stage.utilization = elapsed > 0 ? std::min( stage.busy / elapsed, 1.0 ) : 0;
+			result.push_back( stage );
+		}
+
+		return result;
+	}
+
+	size_t LayerPipeline::inFlight () const
+	{
+		return this->pushed - this->popped;
+	}
+
+	// seconds per sample for each layer, timed over repeated single-sample passes
+	std::vector<double> LayerPipeline::probe () const
+	{
+		std::vector<double> a( this->widest ), b( this->widest ), cost;
+
+		for (size_t j = 0; j < a.size(); ++j)
+			a[j] = std::sin( 0.5 + j );
+
+		for (auto it = this->layers.begin(); it != this->layers.end(); ++it)
+		{
+			const auto begin = std::chrono::steady_clock::now();
+			double seconds = 0;
+			int passes = 0;
+
+			// at least 8 passes, and enough to fill a millisecond, up to 1000
+			while ( passes < 8 || ( seconds < 1e-3 && passes < 1000 ) )
+			{
+				(*it)->forward( a.data(), b.data(), 1 );
+				seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+				++passes;
+			}
+
+			cost.push_back( seconds / passes );
+		}
+
+		return cost;
+	}
+
+	/**
+	 * split the layers into 'count' runs of consecutive layers, so that the most expensive run costs
+	 * as little as possible
+	 *
+	 * best[s][i] is the cheapest way to split the first i layers into s stages, so the split is
+	 * found in O(stages x layers^2), which is nothing next to a single pass
+	 */
+	void LayerPipeline::divide ( const std::vector<double>& cost )
+	{
+		const int n = this->layers.size();
+		const int stages = this->count;
+		const double infinity = std::numeric_limits<double>::infinity();
+
+		std::vector<double> prefix( n + 1, 0 );
+		for (int i = 0; i < n; ++i)
+			prefix[ i + 1 ] = prefix[i] + cost[i];
+
+		std::vector<std::vector<double> > best( stages + 1, std::vector<double>( n + 1, infinity ) );
+		std::vector<std::vector<int> > cut( stages + 1, std::vector<int>( n + 1, 0 ) );
+		best[0][0] = 0;
+
+		for (int s = 1; s <= stages; ++s)
+			for (int i = s; i <= n; ++i)
+				for (int j = s - 1; j < i; ++j)
+				{
+					const double worst = std::max( best[ s - 1 ][j], prefix[i] - prefix[j] );
+					if ( worst < best[s][i] )
+					{
+						best[s][i] = worst;
+						cut[s][i] = j;
+					}
+				}
+
+		this->cost = cost;
+		this->workers.clear();
+
+		for (int s = 0; s < stages; ++s)
+			this->workers.push_back( std::unique_ptr<Worker>( new Worker() ) );
+
+		for (int s = stages, i = n; s > 0; --s)
+		{
+			Worker& worker = *this->workers[ s - 1 ];
+			worker.first = cut[s][i];
+			worker.last = i - 1;
+			i = cut[s][i];
+		}
+	}
+
+	// start a thread for each stage, pinned to a cpu of its own where there are enough to go round
+	void LayerPipeline::start ()
+	{
+		const NumaTopology& topology = NumaTopology::system();
+		std::vector<int> cpus;
+
+		for (int node = 0; node < topology.nodes(); ++node)
+			cpus.insert( cpus.end(), topology.cpus(node).begin(), topology.cpus(node).end() );
+
+		this->rings.clear();
+		for (int s = 0; s <= this->count; ++s)
+			this->rings.push_back( std::unique_ptr<SpscRing<size_t> >( new SpscRing<size_t>( this->depth ) ) );
+
+		this->stopping = false;
+		this->started = std::chrono::steady_clock::now();
+
+		for (int s = 0; s < this->count; ++s)
+		{
+			Worker& worker = *this->workers[s];
+
+			worker.output.assign( this->depth * this->layers[ worker.last ]->size(), 0.0 );
+			worker.timed.assign( worker.last - worker.first + 1, 0 );
+			worker.samples = 0;
+			worker.busy = 0;
+			worker.cpu = -1;
+			worker.thread = std::thread( &LayerPipeline::work, this, s );
+
+#ifdef __linux__
+			// the first cpu is left for the thread feeding the pipeline
+			if ( !cpus.empty() )
+			{
+				const int cpu = cpus[ ( s + 1 ) % cpus.size() ];
+				cpu_set_t set;
+				CPU_ZERO( &set );
+				CPU_SET( cpu, &set );
+
+				if ( pthread_setaffinity_np( worker.thread.native_handle(), sizeof(set), &set ) == 0 )
+					worker.cpu = cpu;
+			}
+#endif
+		}
+	}
+
+	void LayerPipeline::stop ()
+	{
+		this->stopping = true;
+
+		for (auto it = this->workers.begin(); it != this->workers.end(); ++it)
+			if ( (*it)->thread.joinable() )
+				(*it)->thread.join();
+	}
+
+	void LayerPipeline::work ( size_t s )
+	{
+		Tracer::global().nameThread( "pipeline stage " + std::to_string(s) );
+
+		Worker& worker = *this->workers[s];
+		SpscRing<size_t>& in = *this->rings[s];
+		SpscRing<size_t>& out = *this->rings[ s + 1 ];
+
+		const int width = s == 0 ? this->net.inputs() : this->layers[ worker.first - 1 ]->size();
+		const int outputs = this->layers[ worker.last ]->size();
+		const double* source = s == 0 ? this->inputs.data() : this->workers[ s - 1 ]->output.data();
+
+		std::vector<double> a( this->widest ), b( this->widest );
+		unsigned int idle = 0;
+		size_t slot;
+
+		for (;;)
+		{
+			// spin briefly for the next sample, then yield, then sleep once the stream has gone quiet;
+			// whatever is still queued is finished before stopping
+			if ( !in.pop(slot) )
+			{
+				if ( this->stopping.load() )
+					return;
+
+				if ( ++idle > 65536 )
+					std::this_thread::sleep_for( std::chrono::microseconds(50) );
+				else if ( idle > 64 )
+					std::this_thread::yield();
+
+				continue;
+			}
+
+			idle = 0;
+
+			const auto begin = std::chrono::steady_clock::now();
+			auto last = begin;
+			const double* x = source + slot * width;
+
+			for (int l = worker.first; l <= worker.last; ++l)
+			{
+				double* y = l == worker.last ? worker.output.data() + slot * outputs : ( x == a.data() ? b.data() : a.data() );
+				this->layers[l]->forward( x, y, 1 );
+
+				const auto now = std::chrono::steady_clock::now();
+				worker.timed[ l - worker.first ] += std::chrono::duration_cast<std::chrono::nanoseconds>( now - last ).count();
+				last = now;
+				x = y;
+			}
+
+			worker.busy.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>( last - begin ).count(), std::memory_order_relaxed );
+			worker.samples.fetch_add( 1, std::memory_order_relaxed );
+
+			// the ring holds 'depth' slots, so there's always room
+			out.push(slot);
+		}
+	}
+}
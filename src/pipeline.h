@@ -0,0 +1,137 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "network.h"
+#include "spscring.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Layer Pipeline
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * streams single samples through a network with its layers split into pipeline stages
+	 *
+	 * each stage is a run of consecutive layers with a thread of its own, pinned to its own cpu
+	 * where that's supported. Stages hand samples on to the next over lock-free single-producer
+	 * single-consumer rings, so while one sample is in the second stage the next can already be in
+	 * the first, and samples are never held back to make up a batch.
+	 *
+	 * the layers are divided so the most expensive stage costs as little as possible, using the time
+	 * each layer takes on a sample. That's measured with a few probe passes to begin with; the stages
+	 * keep timing their layers as they run, and 'rebalance' re-divides them using those times.
+	 *
+	 * outputs come out in the order the inputs went in. 'push' and 'pop' must be called from the
+	 * same thread (or at least not concurrently). The stage threads poll for work, so they keep
+	 * their cpus busy for a while after the stream goes quiet before backing off. The network
+	 * mustn't be trained while the pipeline is running.
+	 *
+	 */
+	class LayerPipeline
+	{
+	public:
+
+		/**
+		 * :param first, last - the layers of the stage
+		 * :param cpu - the cpu the stage's thread is pinned to, or -1
+		 * :param cost - estimated seconds per sample, from the layer timings the stages were divided by
+		 * :param samples - samples through the stage since it started
+		 * :param busy - seconds spent running the stage's layers
+		 * :param utilization - busy time as a fraction of the time the stage has been running
+		 */
+		struct Stage
+		{
+			int first;
+			int last;
+			int cpu;
+			double cost;
+			unsigned long long samples;
+			double busy;
+			double utilization;
+		};
+
+		/**
+		 * :param net - the network to run
+		 * :param stages - number of stages; 0 for one per cpu (at most one per layer)
+		 * :param depth - most samples in the pipeline at once
+		 */
+		LayerPipeline ( Network&, int = 0, size_t = 64 );
+		~LayerPipeline();
+
+		// feed in the next input; false, without waiting, if 'depth' samples are already in flight
+		bool push ( const std::vector<double>& );
+
+		// take the output of the oldest sample in flight; false, without waiting, if it isn't ready yet
+		bool pop ( std::vector<double>& );
+
+		// stream every input through the pipeline, and return the outputs in order
+		std::vector<std::vector<double> > run ( const std::vector<std::vector<double> >& );
+
+		// re-divide the layers by the time each has taken so far; nothing may be in flight
+		void rebalance ();
+
+		std::vector<Stage> stages () const;
+
+		size_t inFlight () const;
+
+	private:
+
+		struct Worker
+		{
+			int first;
+			int last;
+			int cpu;
+			std::thread thread;
+			std::vector<double> output;		// the stage's output for each slot
+			std::vector<unsigned long long> timed;	// nanoseconds spent in each of the stage's layers
+			std::atomic<unsigned long long> samples;
+			std::atomic<unsigned long long> busy;	// nanoseconds
+		};
+
+		std::vector<double> probe () const;
+		void divide ( const std::vector<double>& );
+		void start ();
+		void stop ();
+		void work ( size_t );
+
+		Network& net;
+		std::vector<Network::Layer*> layers;
+		size_t depth;
+		int count;
+		size_t widest;
+
+		std::vector<double> inputs;		// the input for each slot
+		std::vector<std::unique_ptr<Worker> > workers;
+		std::vector<std::unique_ptr<SpscRing<size_t> > > rings;	// ring k feeds stage k; the last one feeds 'pop'
+		std::vector<double> cost;			// seconds per sample for each layer, as last measured
+		std::atomic<bool> stopping;
+		std::chrono::steady_clock::time_point started;
+
+		size_t pushed;
+		size_t popped;
+
+	}; // end class LayerPipeline
+}
+
+#endif
@@ -0,0 +1,151 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include "network.h"
+#include "selection.h"
+
+namespace machine {
+
+	/**
+	 * :param net - the network to evaluate
+	 * :param outputs - indices of the outputs to compute
+	 */
+	OutputSelection::OutputSelection ( Network& net, std::vector<int> outputs )
+		: net(net), selected(outputs), version(0)
+	{
+		for (auto it = outputs.begin(); it != outputs.end(); ++it)
+			if ( *it < 0 || *it >= net.outputs() )
+				throw std::out_of_range("OutputSelection: no such output");
+
+		for (auto it = net.begin(); it != net.end(); ++it)
+		{
+			if ( it->kernel == Network::Layer::Generic )
+				throw std::invalid_argument("OutputSelection: only networks using the dot product propogation function can be evaluated selectively");
+
+			this->layers.push_back( &*it );
+		}
+
+		this->rows.resize( this->layers.size() );
+		this->activations.resize( this->layers.size() );
+		this->result.resize( outputs.size() );
+		this->plan();
+	}
+
+	/**
+	 * work backwards from the selected outputs, marking the neurons of each layer that feed a
+	 * marked neuron of the next through a nonzero weight
+	 */
+	void OutputSelection::plan ()
+	{
+		const int depth = this->layers.size();
+		std::vector<char> needed( this->layers.back()->size(), 0 );
+
+		for (auto it = this->selected.begin(); it != this->selected.end(); ++it)
+			needed[*it] = 1;
+
+		for (int l = depth - 1; l >= 0; --l)
+		{
+			const Network::Layer& layer = *this->layers[l];
+			const int cols = layer.weights.size() / std::max( layer.size(), 1 );
+
+			this->rows[l].clear();
+			for (int i = 0; i < layer.size(); ++i)
+				if ( needed[i] )
+					this->rows[l].push_back(i);
+
+			this->activations[l].assign( layer.size(), 0.0 );
+
+			if ( l == 0 )
+				break;
+
+			std::vector<char> previous( cols, 0 );
+			for (auto i = this->rows[l].begin(); i != this->rows[l].end(); ++i)
+			{
+				const double* row = layer.weights.data() + (size_t)(*i) * cols;
+				for (int j = 0; j < cols; ++j)
+					if ( row[j] != 0 )
+						previous[j] = 1;
+			}
+
+			needed.swap( previous );
+		}
+
+		this->version = this->net.version();
+	}
+
+	const std::vector<double>& OutputSelection::evaluate ( const std::vector<double>& input )
+	{
+		if ( (int)input.size() != this->net.inputs() )
+			throw std::invalid_argument("OutputSelection: expected " + std::to_string( this->net.inputs() ) + " inputs");
+
+		if ( this->net.version() != this->version )
+			this->plan();
+
+		const double* in = input.data();
+
+		for (size_t l = 0; l < this->layers.size(); ++l)
+		{
+			const Network::Layer& layer = *this->layers[l];
+			const ActFunction& actf = this->net.activate( layer.index );
+			const int cols = layer.weights.size() / std::max( layer.size(), 1 );
+			double* out = this->activations[l].data();
+
+			if ( layer.kernel == Network::Layer::Sparse )
+			{
+				// the nonzeros of each row in the same order as the sparse kernel
+				const int* start = layer.sparseRows.data();
+				const int* column = layer.sparseColumns.data();
+				const double* value = layer.sparseValues.data();
+
+				for (auto i = this->rows[l].begin(); i != this->rows[l].end(); ++i)
+				{
+					double sum = 0;
+					for (int k = start[*i]; k < start[*i + 1]; ++k)
+						sum += in[ column[k] ] * value[k];
+
+					out[*i] = actf.dxdy(sum);
+				}
+			}
+			else
+			{
+				for (auto i = this->rows[l].begin(); i != this->rows[l].end(); ++i)
+					out[*i] = actf.dxdy( dot( in, layer.weights.data() + (size_t)(*i) * cols, cols ) );
+			}
+
+			in = out;
+		}
+
+		for (size_t k = 0; k < this->selected.size(); ++k)
+			this->result[k] = this->activations.back()[ this->selected[k] ];
+
+		return this->result;
+	}
+
+	const std::vector<int>& OutputSelection::outputs () const
+	{
+		return this->selected;
+	}
+
+	int OutputSelection::neurons () const
+	{
+		int n = 0;
+		for (auto it = this->rows.begin(); it != this->rows.end(); ++it)
+			n += it->size();
+
+		return n;
+	}
+}
@@ -0,0 +1,72 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <vector>
+
+#include "network.h"
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Output Selection
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * evaluates only some of a network's outputs
+	 *
+	 * only the selected rows of the output layer are computed, and, working backwards, only the
+	 * neurons of each earlier layer that have a nonzero weight into a neuron that is computed. In a
+	 * dense network that's every hidden neuron, but after pruning the cone of neurons an output
+	 * depends on can be much smaller.
+	 *
+	 * the activations of the neurons that are skipped are left at zero, so the computed neurons get
+	 * the same sums, bit for bit, as in a full feedForward.
+	 *
+	 * the cone is worked out when the selection is made and again whenever the network's version
+	 * changes; every buffer is allocated up front, so evaluating doesn't touch the heap.
+	 *
+	 */
+	class OutputSelection
+	{
+	public:
+
+		OutputSelection ( Network&, std::vector<int> );
+
+		// the selected outputs for 'input', in the order they were selected in
+		const std::vector<double>& evaluate ( const std::vector<double>& );
+
+		const std::vector<int>& outputs () const;
+
+		// number of neurons evaluated per input, out of the network's total
+		int neurons () const;
+
+	private:
+
+		void plan ();
+
+		Network& net;
+		std::vector<Network::Layer*> layers;
+		std::vector<int> selected;
+		unsigned long long version;
+
+		std::vector<std::vector<int> > rows;			// the neurons computed in each layer, in order
+		std::vector<std::vector<double> > activations;	// the output of each layer; zero where skipped
+		std::vector<double> result;
+
+	}; // end class OutputSelection
+}
+
+#endif
@@ -0,0 +1,109 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 								Single Producer Ring
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * a bounded lock-free queue between exactly one producer thread and one consumer thread
+	 *
+	 * 'head' is only written by the producer and 'tail' only by the consumer, each with a release
+	 * store that publishes the slot it just filled or emptied; they're kept on separate cache lines
+	 * so the two threads don't bounce a line between them on every call. Each side also keeps its
+	 * own copy of the other's index, and only reloads it when the ring looks full (or empty).
+	 *
+	 */
+	template <class T>
+	class SpscRing
+	{
+	public:
+
+		// the capacity is rounded up to a power of two
+		explicit SpscRing ( size_t capacity )
+			: head(0), cachedTail(0), tail(0), cachedHead(0)
+		{
+			size_t n = 2;
+			while ( n < capacity )
+				n <<= 1;
+
+			this->slots.resize(n);
+			this->mask = n - 1;
+		}
+
+		// producer only; returns false, without waiting, when the ring is full
+		bool push ( const T& value )
+		{
+			const size_t h = this->head.load( std::memory_order_relaxed );
+
+			if ( h - this->cachedTail > this->mask )
+			{
+				this->cachedTail = this->tail.load( std::memory_order_acquire );
+				if ( h - this->cachedTail > this->mask )
+					return false;
+			}
+
+			this->slots[ h & this->mask ] = value;
+			this->head.store( h + 1, std::memory_order_release );
+			return true;
+		}
+
+		// consumer only; returns false when the ring is empty
+		bool pop ( T& value )
+		{
+			const size_t t = this->tail.load( std::memory_order_relaxed );
+
+			if ( t == this->cachedHead )
+			{
+				this->cachedHead = this->head.load( std::memory_order_acquire );
+				if ( t == this->cachedHead )
+					return false;
+			}
+
+			value = this->slots[ t & this->mask ];
+			this->tail.store( t + 1, std::memory_order_release );
+			return true;
+		}
+
+		size_t capacity () const
+		{
+			return this->slots.size();
+		}
+
+	private:
+
+		std::vector<T> slots;
+		size_t mask;
+
+		char pad0[64];
+		std::atomic<size_t> head;	// next slot to fill; written by the producer
+		size_t cachedTail;			// the producer's copy of tail
+		char pad1[64];
+		std::atomic<size_t> tail;	// next slot to empty; written by the consumer
+		size_t cachedHead;			// the consumer's copy of head
+		char pad2[64];
+
+	}; // end class SpscRing
+}
+
+#endif
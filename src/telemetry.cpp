@@ -0,0 +1,183 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+#include "telemetry.h"
+
+namespace machine {
+
+	Telemetry::Telemetry ( std::string file, Format format, int window, size_t capacity )
+		: ring(capacity), format(format), window( window > 0 ? window : 1 ), queued(0), written(0), dropped(0), running(true)
+	{
+		if ( !file.empty() )
+		{
+			this->out.open( file, std::ios::out | std::ios::trunc );
+			if ( !this->out )
+				throw std::runtime_error("Telemetry: couldn't open '" + file + "' for writing");
+
+			if ( this->format == CSV )
+				this->out << "step,batch,loss,samples_per_second,rate,gradient_norm,seconds\n";
+		}
+
+		this->reader = std::thread( &Telemetry::drain, this );
+	}
+
+	Telemetry::~Telemetry()
+	{
+		this->running = false;
+		this->reader.join();
+	}
+
+	bool Telemetry::record ( const TrainingRecord& r )
+	{
+		if ( !this->ring.push(r) )
+		{
+			this->dropped.fetch_add( 1, std::memory_order_relaxed );
+			return false;
+		}
+
+		this->queued.fetch_add( 1, std::memory_order_relaxed );
+		return true;
+	}
+
+	Telemetry::Aggregates Telemetry::aggregates () const
+	{
+		Aggregates a = Aggregates();
+		a.dropped = this->dropped.load();
+
+		std::lock_guard<std::mutex> lock( this->recentMutex );
+		a.steps = this->written.load();
+		a.window = this->recent.size();
+
+		if ( this->recent.empty() )
+			return a;
+
+		double samples = 0;
+		int norms = 0;
+		for (auto it = this->recent.begin(); it != this->recent.end(); ++it)
+		{
+			a.loss += it->loss;
+			a.seconds += it->seconds;
+			samples += it->batch;
+
+			if ( !std::isnan( it->gradientNorm ) )
+			{
+				a.gradientNorm += it->gradientNorm;
+				++norms;
+			}
+		}
+
+		a.samplesPerSecond = a.seconds > 0 ? samples / a.seconds : 0;
+		a.loss /= a.window;
+		a.gradientNorm = norms > 0 ? a.gradientNorm / norms : std::numeric_limits<double>::quiet_NaN();
+		a.seconds /= a.window;
+		a.rate = this->recent.back().rate;
+		return a;
+	}
+
+	void Telemetry::flush ()
+	{
+		const unsigned long long target = this->queued.load();
+		while ( this->written.load() < target )
+			std::this_thread::sleep_for( std::chrono::microseconds(200) );
+	}
+
+	Telemetry::Format Telemetry::formatOf ( const std::string& file )
+	{
+		const std::string ext = ".csv";
+		if ( file.size() >= ext.size() && file.compare( file.size() - ext.size(), ext.size(), ext ) == 0 )
+			return CSV;
+
+		return NDJSON;
+	}
+
+	/**
+	 * the reader thread: empty the ring, write out what was in it, and sleep for a few milliseconds
+	 * when there's nothing to do. The file is flushed after each batch of records, so it can be
+	 * followed while the network trains.
+	 */
+	void Telemetry::drain ()
+	{
+		for (;;)
+		{
+			// read the flag before emptying the ring, so nothing pushed before the destructor ran is missed
+			const bool stopping = !this->running.load();
+			TrainingRecord r;
+			unsigned long long n = 0;
+
+			{
+				std::lock_guard<std::mutex> lock( this->recentMutex );
+
+				while ( this->ring.pop(r) )
+				{
+					this->write(r);
+
+					this->recent.push_back(r);
+					if ( (int)this->recent.size() > this->window )
+						this->recent.pop_front();
+
+					this->written.fetch_add( 1, std::memory_order_release );
+					++n;
+				}
+			}
+
+			if ( n > 0 && this->out.is_open() )
+				this->out.flush();
+
+			if ( stopping )
+				return;
+
+			if ( n == 0 )
+				std::this_thread::sleep_for( std::chrono::milliseconds(5) );
+		}
+	}
+
+	// JSON has no representation of NaN or infinity
+	static void number ( char* buf, size_t n, double x, bool json )
+	{
+		if ( std::isfinite(x) )
+			std::snprintf( buf, n, "%.9g", x );
+		else
+			std::snprintf( buf, n, "%s", json ? "null" : ( std::isnan(x) ? "nan" : ( x > 0 ? "inf" : "-inf" ) ) );
+	}
+
+	void Telemetry::write ( const TrainingRecord& r )
+	{
+		if ( !this->out.is_open() )
+			return;
+
+		const bool json = this->format == NDJSON;
+		char loss[32], throughput[32], rate[32], norm[32], seconds[32], line[256];
+
+		number( loss, sizeof(loss), r.loss, json );
+		number( throughput, sizeof(throughput), r.samplesPerSecond, json );
+		number( rate, sizeof(rate), r.rate, json );
+		number( norm, sizeof(norm), r.gradientNorm, json );
+		number( seconds, sizeof(seconds), r.seconds, json );
+
+		if ( json )
+			std::snprintf( line, sizeof(line), "{\"step\":%llu,\"batch\":%d,\"loss\":%s,\"samples_per_second\":%s,\"rate\":%s,\"gradient_norm\":%s,\"seconds\":%s}\n",
+				r.step, r.batch, loss, throughput, rate, norm, seconds );
+		else
+			std::snprintf( line, sizeof(line), "%llu,%d,%s,%s,%s,%s,%s\n", r.step, r.batch, loss, throughput, rate, norm, seconds );
+
+		this->out << line;
+	}
+}
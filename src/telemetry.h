@@ -0,0 +1,139 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spscring.h"
+
+namespace machine {
+
+	/**
+	 * one training step, as recorded by Network::train
+	 *
+	 * :param step - number of the step, counting from 1
+	 * :param batch - number of samples in the step
+	 * :param loss - the loss training minimizes (half the squared error, or the softmax cross-entropy), summed over
+	 *               the outputs and averaged over the batch
+	 * :param samplesPerSecond - batch / seconds
+	 * :param rate - the learning rate
+	 * :param gradientNorm - L2 norm of the gradient of every layer together; NaN on the steps it wasn't measured
+	 * :param seconds - wall time of the step
+	 */
+	struct TrainingRecord
+	{
+		unsigned long long step;
+		int batch;
+		double loss;
+		double samplesPerSecond;
+		double rate;
+		double gradientNorm;
+		double seconds;
+	};
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									Telemetry
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * streams a record of every training step to a file, and keeps rolling aggregates of the most recent ones
+	 *
+	 * the training thread only pushes each record onto a lock-free ring and carries on; a reader
+	 * thread of its own drains the ring, writes the records out (as newline-delimited JSON, or CSV)
+	 * and updates the aggregates. If the reader falls so far behind that the ring fills up, records
+	 * are dropped (and counted) rather than making the training loop wait.
+	 *
+	 * 'record' must only ever be called from one thread at a time.
+	 *
+	 */
+	class Telemetry
+	{
+	public:
+
+		enum Format { NDJSON, CSV };
+
+		/**
+		 * means over the last 'window' steps (the learning rate is the latest one)
+		 *
+		 * :param steps - records written so far
+		 * :param dropped - records lost because the ring was full
+		 * :param samplesPerSecond - samples over the window / seconds over the window
+		 * :param gradientNorm - mean of the norms measured within the window
+		 */
+		struct Aggregates
+		{
+			unsigned long long steps;
+			unsigned long long dropped;
+			int window;
+			double loss;
+			double samplesPerSecond;
+			double rate;
+			double gradientNorm;
+			double seconds;
+		};
+
+		/**
+		 * :param file - where to write the records; an empty name keeps only the aggregates
+		 * :param format - the file format
+		 * :param window - number of steps the aggregates are taken over
+		 * :param capacity - number of records the ring holds
+		 */
+		Telemetry ( std::string, Format = NDJSON, int = 100, size_t = 4096 );
+		~Telemetry();
+
+		// queue a record; never blocks, and returns false if it had to be dropped
+		bool record ( const TrainingRecord& );
+
+		Aggregates aggregates () const;
+
+		// wait until every record queued so far has been written out
+		void flush ();
+
+		// CSV for a file ending in '.csv', otherwise NDJSON
+		static Format formatOf ( const std::string& );
+
+	private:
+
+		void drain ();
+		void write ( const TrainingRecord& );
+
+		SpscRing<TrainingRecord> ring;
+		Format format;
+		int window;
+		std::ofstream out;
+
+		std::atomic<unsigned long long> queued;
+		std::atomic<unsigned long long> written;
+		std::atomic<unsigned long long> dropped;
+		std::atomic<bool> running;
+
+		// the last 'window' records; only the reader thread adds to it
+		std::deque<TrainingRecord> recent;
+		mutable std::mutex recentMutex;
+
+		std::thread reader;
+
+	}; // end class Telemetry
+}
+
+#endif
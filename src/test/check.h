@@ -0,0 +1,65 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cmath>
+#include <cstdio>
+
+/**
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * 									Test Checks
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * each test is a program of its own; a failed check is reported and counted, and the program
+ * returns the count from main with CHECK_RESULT, so 'make test' stops at the first failing test
+ *
+ */
+
+static int check_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if ( !(condition) ) \
+		{ \
+			std::fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition ); \
+			++check_failures; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		const double check_a = (a), check_b = (b); \
+		if ( !( std::fabs( check_a - check_b ) <= (tolerance) ) ) \
+		{ \
+			std::fprintf( stderr, "%s:%d: check failed: %s = %.17g, %s = %.17g\n", __FILE__, __LINE__, #a, check_a, #b, check_b ); \
+			++check_failures; \
+		} \
+	} while (0)
+
+#define CHECK_THROWS(expression, type) \
+	do { \
+		bool check_threw = false; \
+		try { expression; } catch ( const type& ) { check_threw = true; } \
+		if ( !check_threw ) \
+		{ \
+			std::fprintf( stderr, "%s:%d: check failed: %s didn't throw %s\n", __FILE__, __LINE__, #expression, #type ); \
+			++check_failures; \
+		} \
+	} while (0)
+
+#define CHECK_RESULT() ( check_failures == 0 ? 0 : 1 )
+
+#endif
@@ -0,0 +1,153 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+#include "threadpool.h"
+
+using namespace machine;
+
+// every allocation made while 'counting' is set, on any thread
+static std::atomic<bool> counting( false );
+static std::atomic<int> allocations( 0 );
+
+void* operator new ( size_t n )
+{
+	if ( counting )
+		++allocations;
+
+	void* p = std::malloc( n ? n : 1 );
+	if ( !p )
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete ( void* p ) noexcept
+{
+	std::free(p);
+}
+
+void operator delete ( void* p, size_t ) noexcept
+{
+	std::free(p);
+}
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// once the first step has sized everything, a training step doesn't touch the heap
+static void trainsWithoutAllocating ( Network::Parameters& p, int batch, bool parallel = false )
+{
+	p.layerSizes( std::vector<unsigned int>{ 24, 40, 32, 28, 6 } ).seed(9).batchSize( batch );
+	Network net(&p);
+
+	// the layers are too small to be given the Parallel kernel, so force it
+	if ( parallel )
+		for (auto it = net.begin(); it != net.end(); ++it)
+			it->kernel = Network::Layer::Parallel;
+
+	// the arguments are made up front and moved in, so only the step itself is counted
+	std::vector<std::vector<double> > in, out;
+	for (int i = 0; i < 12; ++i)
+	{
+		in.push_back( input( 24 * batch, i ) );
+		out.push_back( input( 6 * batch, -i ) );
+	}
+
+	for (int i = 0; i < 2; ++i)
+		net.train( std::move(in[i]), std::move(out[i]) );
+
+	allocations = 0;
+	counting = true;
+	for (int i = 2; i < 12; ++i)
+		net.train( std::move(in[i]), std::move(out[i]) );
+	counting = false;
+
+	CHECK( allocations == 0 );
+}
+
+// a parallel loop on a pool with workers doesn't allocate, nested or not
+static void loopsWithoutAllocating ()
+{
+	ThreadPool pool(3);
+	std::vector<double> sums( 64 );
+
+	auto inner = [&]( size_t lo, size_t hi ) {
+		for (size_t i = lo; i < hi; ++i)
+			sums[i] += 1;
+	};
+	// each chunk yields its cpu for a moment, so that the workers get to take up invitations
+	auto outer = [&]( size_t lo, size_t hi ) {
+		for (size_t i = lo; i < hi; ++i)
+		{
+			pool.parallelFor( i * 8, i * 8 + 8, 1, std::cref(inner) );
+			std::this_thread::sleep_for( std::chrono::microseconds(20) );
+		}
+	};
+
+	pool.parallelFor( 0, 8, 1, std::cref(outer) );
+
+	allocations = 0;
+	counting = true;
+	for (int i = 0; i < 1000; ++i)
+		pool.parallelFor( 0, 8, 1, std::cref(outer) );
+	counting = false;
+
+	CHECK( allocations == 0 );
+	for (size_t i = 0; i < sums.size(); ++i)
+		CHECK( sums[i] == 1001 );
+}
+
+int main ()
+{
+	loopsWithoutAllocating();
+
+	Network::Parameters plain;
+	trainsWithoutAllocating( plain.training( adam ), 1 );
+
+	Network::Parameters mixed;
+	trainsWithoutAllocating( mixed.mixedPrecision( true ).training( momentum ), 1 );
+
+	Network::Parameters checkpointed;
+	trainsWithoutAllocating( checkpointed.mixedPrecision( true ).checkpointInterval(2).training( adam ), 4 );
+
+	Network::Parameters budget;
+	trainsWithoutAllocating( budget.memoryBudget( 2048 ).training( rmsprop ), 3 );
+
+	Network::Parameters parallel;
+	trainsWithoutAllocating( parallel.training( adam ), 2, true );
+
+	Network::Parameters mixedParallel;
+	trainsWithoutAllocating( mixedParallel.mixedPrecision( true ).training( adam ), 2, true );
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,80 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <vector>
+
+#include "async.h"
+#include "check.h"
+#include "network.h"
+#include "threadpool.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// every request completes, with the output feedForward gives, whether it's batched with others or not
+static void answersEveryRequest ()
+{
+	Network::Parameters p;
+	p.inputs(16).outputs(4).hiddenLayers(2).hiddenSize(32).seed(9);
+	Network net(&p);
+
+	std::vector<std::vector<double> > expected;
+	for (int i = 0; i < 200; ++i)
+		expected.push_back( net.feedForward( input( 16, i ) ) );
+
+	ThreadPool pool(2);
+	std::vector<std::future<std::vector<double> > > results;
+	std::atomic<int> mismatches(0);
+	{
+		InferenceQueue queue( net, 8, 4, pool );
+
+		for (int i = 0; i < 200; ++i)
+		{
+			if ( i % 2 )
+				results.push_back( queue.submit( input( 16, i ) ) );
+			else
+				queue.submit( input( 16, i ), [&expected, &mismatches, i]( std::vector<double> out, std::exception_ptr error ) {
+					if ( error || out != expected[i] )
+						++mismatches;
+				});
+		}
+
+		queue.wait();
+		CHECK( queue.inFlight() == 0 );
+	}
+
+	CHECK( mismatches == 0 );
+	for (size_t i = 0; i < results.size(); ++i)
+		CHECK( results[i].get() == expected[ 2 * i + 1 ] );
+}
+
+int main ()
+{
+	answersEveryRequest();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,152 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// the loss backPropogation minimizes: half the squared error, averaged over the batch
+static double loss ( Network& net, const std::vector<double>& x, const std::vector<double>& expected )
+{
+	const int batch = x.size() / net.inputs();
+	double sum = 0;
+
+	for (int b = 0; b < batch; ++b)
+	{
+		std::vector<double> sample( x.begin() + b * net.inputs(), x.begin() + ( b + 1 ) * net.inputs() );
+		std::vector<double> out = net.feedForward( sample );
+		for (int i = 0; i < net.outputs(); ++i)
+			sum += 0.5 * ( out[i] - expected[ b * net.outputs() + i ] ) * ( out[i] - expected[ b * net.outputs() + i ] );
+	}
+
+	return sum / batch;
+}
+
+// the largest difference between the gradient of the last training step of 'trained' and central
+// differences of the loss of 'net', which has the same weights
+static double gradientError ( Network& trained, Network& net, const std::vector<double>& x, const std::vector<double>& expected )
+{
+	const double h = 1e-5;
+	double worst = 0;
+
+	auto layer = trained.begin();
+	for (auto it = net.begin(); it != net.end(); ++it, ++layer)
+		for (size_t i = 0; i < it->weights.size(); ++i)
+		{
+			const double w = it->weights[i];
+			it->weights[i] = w + h;
+			const double above = loss( net, x, expected );
+			it->weights[i] = w - h;
+			const double below = loss( net, x, expected );
+			it->weights[i] = w;
+
+			worst = std::max( worst, std::fabs( ( above - below ) / ( 2 * h ) - layer->gradient[i] ) );
+		}
+
+	return worst;
+}
+
+// the derivatives of the activation functions are taken at the outputs the forward pass recorded
+static void checksGradients ( const ActFunction& actf )
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 5, 6, 4, 3 } ).activation(actf).rate(0).batchSize(2).seed(8);
+	Network net(&p);
+
+	const std::vector<double> x = input( 10, 0.3 );
+	const std::vector<double> expected = { 0.9, 0.1, 0.4, 0.2, 0.7, 0.5 };
+	net.train( x, expected );
+
+	CHECK( gradientError( net, net, x, expected ) < 1e-8 );
+
+	// the same derivatives in float32
+	Network::Parameters q(p);
+	q.mixedPrecision(true);
+	Network mixed(&q);
+	mixed.train( x, expected );
+	CHECK( gradientError( mixed, net, x, expected ) < 1e-5 );
+}
+
+// a mixed precision step that overflows leaves the weights, and the version derived state is keyed on, alone
+static void skipsOverflowedSteps ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 5, 6, 3 } ).mixedPrecision(true).lossScale(1e39).seed(8);
+	Network net(&p);
+
+	std::vector<std::vector<double> > before;
+	for (auto it = net.begin(); it != net.end(); ++it)
+		before.push_back( it->weights );
+
+	const unsigned long long version = net.version();
+	net.train( input( 5, 0.3 ), std::vector<double>{ 0.9, 0.1, 0.4 } );
+
+	CHECK( net.lossScale() < 1e39 );
+	CHECK( net.version() == version );
+
+	size_t l = 0;
+	for (auto it = net.begin(); it != net.end(); ++it, ++l)
+		CHECK( it->weights == before[l] );
+}
+
+// recomputing the activations between checkpoints gives the same gradients as keeping them all
+static void checkpointsMatchFullActivations ( bool mixed )
+{
+	std::vector<std::vector<std::vector<double> > > trained;
+
+	for (int k = 1; k <= 3; ++k)
+	{
+		Network::Parameters p;
+		p.layerSizes( std::vector<unsigned int>{ 7, 12, 10, 9, 11, 8, 3 } ).training(adam).mixedPrecision(mixed).checkpointInterval(k).batchSize(3).seed(21);
+		Network net(&p);
+		CHECK( net.checkpointInterval() == k );
+
+		for (int i = 0; i < 10; ++i)
+			net.train( input( 21, i ), input( 9, -0.5 * i ) );
+
+		trained.push_back( std::vector<std::vector<double> >() );
+		for (auto it = net.begin(); it != net.end(); ++it)
+			trained.back().push_back( it->weights );
+	}
+
+	CHECK( trained[1] == trained[0] );
+	CHECK( trained[2] == trained[0] );
+}
+
+int main ()
+{
+	skipsOverflowedSteps();
+	checkpointsMatchFullActivations( false );
+	checkpointsMatchFullActivations( true );
+	checksGradients( sigmoid );
+	checksGradients( softplus );
+	checksGradients( hyperbolic_tan );
+
+	return CHECK_RESULT();
+}
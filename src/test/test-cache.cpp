@@ -0,0 +1,103 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "cache.h"
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// repeated inputs are served from the cache, and a result is never reused after the weights change
+static void hitsAndInvalidates ()
+{
+	Network::Parameters p;
+	p.inputs(8).outputs(3).hiddenLayers(1).hiddenSize(16).seed(1).cacheSize( 1 << 20 );
+	Network net(&p);
+	InferenceCache& cache = *net.cache();
+
+	const std::vector<double> x = input( 8, 0.5 );
+	const std::vector<double> first = net.feedForward(x);
+	CHECK( net.feedForward(x) == first );
+	CHECK( cache.stats().hits == 1 );
+	CHECK( cache.stats().entries == 1 );
+
+	net.train( x, std::vector<double>{ 1, 0, 0 } );
+	CHECK( cache.stats().entries == 0 );
+
+	const std::vector<double> trained = net.feedForward(x);
+	CHECK( trained != first );
+	CHECK( cache.stats().entries == 1 );
+	CHECK( cache.stats().hits == 1 );
+
+	for (int i = 0; i < 5; ++i)
+		CHECK( net.feedForward(x) == trained );
+	CHECK( cache.stats().hits == 6 );
+}
+
+// training leaves the network in the mode it found it in, even when the step throws
+static void trainingKeepsTheCallersMode ()
+{
+	Network::Parameters p;
+	p.inputs(4).outputs(2).hiddenLayers(1).hiddenSize(4).seed(2).cacheSize( 1 << 16 );
+	Network net(&p);
+
+	net.train( input( 4, 1 ), std::vector<double>{ 0, 1 } );
+	CHECK( !net.trainingMode() );
+
+	CHECK_THROWS( net.train( input( 3, 1 ), std::vector<double>{ 0, 1 } ), std::invalid_argument );
+	CHECK( !net.trainingMode() );
+
+	net.toggleTrainingMode();
+	net.train( input( 4, 1 ), std::vector<double>{ 0, 1 } );
+	CHECK( net.trainingMode() );
+}
+
+// a cache too small for anything never holds more than its capacity
+static void evicts ()
+{
+	InferenceCache cache( 4096, 1 );
+	for (int i = 0; i < 1000; ++i)
+		cache.insert( input( 8, i ), 1, input( 4, i ) );
+
+	InferenceCache::Stats stats = cache.stats();
+	CHECK( stats.bytes <= stats.capacity );
+	CHECK( stats.evictions > 0 );
+
+	std::vector<double> out;
+	CHECK( cache.lookup( input( 8, 999 ), 1, out ) && out == input( 4, 999 ) );
+	CHECK( !cache.lookup( input( 8, 999 ), 2, out ) );
+}
+
+int main ()
+{
+	hitsAndInvalidates();
+	trainingKeepsTheCallersMode();
+	evicts();
+
+	return CHECK_RESULT();
+}
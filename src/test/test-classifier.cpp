@@ -0,0 +1,155 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "classifier.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// the largest difference between the gradient of the last training step and central differences of the loss
+static double gradientError ( Network& trained, Network& net, const std::vector<double>& x, double label )
+{
+	Classifier<double> classifier(net);
+	const double h = 1e-5;
+	double worst = 0;
+
+	auto layer = trained.begin();
+	for (auto it = net.begin(); it != net.end(); ++it, ++layer)
+		for (size_t i = 0; i < it->weights.size(); ++i)
+		{
+			const double w = it->weights[i];
+			it->weights[i] = w + h;
+			const double above = classifier.loss( x, label );
+			it->weights[i] = w - h;
+			const double below = classifier.loss( x, label );
+			it->weights[i] = w;
+
+			worst = std::max( worst, std::fabs( ( above - below ) / ( 2 * h ) - layer->gradient[i] ) );
+		}
+
+	return worst;
+}
+
+// backPropogation takes the softmax cross-entropy gradient of the logits, in double and in float32
+static void checksGradients ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 6, 5, 3 } ).softmaxOutput(true).rate(0).seed(5);
+	Network net(&p);
+	Classifier<double> classifier(net);
+
+	const std::vector<double> x = input( 6, 0.75 );
+	const double loss = classifier.loss( x, 2 );
+	CHECK_NEAR( classifier.train( x, 2 ), loss, 1e-12 );
+	CHECK( gradientError( net, net, x, 2 ) < 1e-8 );
+
+	Network::Parameters q(p);
+	q.mixedPrecision(true);
+	Network mixed(&q);
+	Classifier<double>( mixed ).train( x, 2 );
+	CHECK( gradientError( mixed, net, x, 2 ) < 1e-5 );
+}
+
+// the output layer is linear, so the classifier can get arbitrarily confident
+static void learnsConfidentProbabilities ()
+{
+	Network::Parameters p;
+	p.inputs(6).outputs(4).hiddenLayers(1).hiddenSize(8).softmaxOutput(true).rate(0.5).seed(6);
+	Network net(&p);
+	Classifier<int> classifier(net);
+
+	const std::vector<double> x = input( 6, 0.1 );
+	double previous = classifier.loss( x, 3 );
+	for (int i = 0; i < 200; ++i)
+	{
+		CHECK_NEAR( classifier.train( x, 3 ), previous, 1e-12 );
+		const double loss = classifier.loss( x, 3 );
+		CHECK( loss < previous );
+		previous = loss;
+	}
+
+	CHECK( classifier.predict(x) == 3 );
+	CHECK( classifier.probabilities(x)[3] > 0.95 );
+}
+
+// a network whose outputs have been through a bounded activation function can't be used as a classifier
+static void rejectsBoundedOutputs ()
+{
+	Network::Parameters p;
+	p.inputs(4).outputs(3).seed(7);
+	Network net(&p);
+
+	CHECK_THROWS( Classifier<int> classifier(net), std::invalid_argument );
+	CHECK( !net.softmaxOutput() );
+}
+
+// against a one-hot target the cross-entropy is the single-class kernel's, and against soft targets
+// its gradient is the loss's numerical derivative
+static void takesTargetProbabilities ()
+{
+	const double x[4] = { 0.3, -1.2, 2.0, 0.5 };
+	const double onehot[4] = { 0, 0, 1, 0 };
+	const double soft[4] = { 0.1, 0.2, 0.6, 0.1 };
+	double grad[4], expected[4];
+
+	CHECK_NEAR( softmaxCrossEntropy( x, 4, onehot, grad ), softmaxCrossEntropy( x, 4, (size_t)2, expected ), 1e-12 );
+	for (int i = 0; i < 4; ++i)
+		CHECK_NEAR( grad[i], expected[i], 1e-12 );
+
+	softmaxCrossEntropy( x, 4, soft, grad );
+	for (int i = 0; i < 4; ++i)
+	{
+		double up[4], down[4];
+		std::copy( x, x + 4, up );
+		std::copy( x, x + 4, down );
+		up[i] += 1e-6;
+		down[i] -= 1e-6;
+
+		const double numeric = ( softmaxCrossEntropy( up, 4, soft, nullptr ) - softmaxCrossEntropy( down, 4, soft, nullptr ) ) / 2e-6;
+		CHECK_NEAR( grad[i], numeric, 1e-6 );
+	}
+
+	// the gradient may be written over the scores
+	double inPlace[4] = { 0.3, -1.2, 2.0, 0.5 };
+	softmaxCrossEntropy( inPlace, 4, soft, inPlace );
+	for (int i = 0; i < 4; ++i)
+		CHECK_NEAR( inPlace[i], grad[i], 1e-15 );
+}
+
+int main ()
+{
+	takesTargetProbabilities();
+	checksGradients();
+	learnsConfidentProbabilities();
+	rejectsBoundedOutputs();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,180 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "check.h"
+#include "collective.h"
+#include "network.h"
+
+using namespace machine;
+
+// the forked workers report a failed check by throwing, which fails their launch
+#define REQUIRE(condition) \
+	do { \
+		if ( !(condition) ) \
+			throw std::runtime_error( "requirement failed: " #condition ); \
+	} while (0)
+
+static const int workers = 4;
+static const int batch = 8;
+static const int steps = 100;
+
+static Network::Parameters parameters ( int batchSize )
+{
+	Network::Parameters p;
+	p.inputs(16).outputs(2).hiddenLayers(2).hiddenSize(32).initialization(xavier).seed(10).batchSize(batchSize);
+	return p;
+}
+
+// 'count' samples starting at sample 'first' of a fixed two-class problem
+static void samples ( size_t first, size_t count, std::vector<double>& input, std::vector<double>& expected )
+{
+	input.clear();
+	expected.clear();
+
+	for (size_t s = first; s < first + count; ++s)
+	{
+		for (int j = 0; j < 16; ++j)
+			input.push_back( std::sin( s * 0.37 + j ) );
+
+		expected.push_back( std::sin( s * 0.37 ) > 0 );
+		expected.push_back( std::sin( s * 0.37 ) <= 0 );
+	}
+}
+
+static std::vector<double> weights ( Network& net )
+{
+	std::vector<double> w;
+	for (auto it = net.rbegin(); it != net.rend(); ++it)
+		w.insert( w.end(), (*it)->weights.begin(), (*it)->weights.end() );
+
+	return w;
+}
+
+/**
+ * every worker trains on its own shard of each step's samples, started from a different seed; the
+ * copies must come out bit for bit the same as each other, and match one process training on the
+ * combined batch to within rounding
+ */
+static void trainsShards ()
+{
+	const bool ok = launch( workers, []( Communicator& group ) {
+		Network::Parameters p = parameters(batch);
+		p.seed( 10 + group.rank() );
+		Network net(&p);
+		net.distribute(&group);
+
+		std::vector<double> input, expected;
+		for (int s = 0; s < steps; ++s)
+		{
+			samples( ( s * workers + group.rank() ) * batch, batch, input, expected );
+			net.train( input, expected );
+		}
+
+		std::vector<double> mine = weights(net), first = mine;
+		group.broadcast( first.data(), first.size(), 0 );
+		REQUIRE( mine == first );
+
+		if ( group.rank() != 0 )
+			return;
+
+		Network::Parameters q = parameters( workers * batch );
+		Network alone(&q);
+		for (int s = 0; s < steps; ++s)
+		{
+			samples( s * workers * batch, workers * batch, input, expected );
+			alone.train( input, expected );
+		}
+
+		std::vector<double> reference = weights(alone);
+		for (size_t i = 0; i < mine.size(); ++i)
+			REQUIRE( std::fabs( mine[i] - reference[i] ) < 1e-12 );
+	} );
+
+	CHECK( ok );
+}
+
+// lengths that don't divide into the members, and longer than the buffer, so they're reduced in pieces
+static void reducesUnevenLengths ()
+{
+	const bool ok = launch( 3, []( Communicator& group ) {
+		const size_t lengths[] = { 1, 2, 5, 1000, 10007 };
+
+		for (size_t n : lengths)
+		{
+			std::vector<double> v(n);
+			for (size_t i = 0; i < n; ++i)
+				v[i] = group.rank() * 1000.0 + i;
+
+			group.allreduce( v.data(), n );
+
+			for (size_t i = 0; i < n; ++i)
+				REQUIRE( v[i] == 3000.0 + 3.0 * i );
+		}
+
+		std::vector<double> b( 7, group.rank() + 1.0 );
+		group.broadcast( b.data(), b.size(), 2 );
+		REQUIRE( std::count( b.begin(), b.end(), 3.0 ) == 7 );
+
+		group.barrier();
+	}, 4096 );
+
+	CHECK( ok );
+}
+
+// a worker that throws, or exits without returning, aborts the rest of the group instead of leaving them waiting
+static void abortsOnFailure ()
+{
+	CHECK( !launch( 3, []( Communicator& group ) {
+		std::vector<double> v(1000);
+		if ( group.rank() == 1 )
+			throw std::runtime_error("a deliberate failure");
+
+		group.allreduce( v.data(), v.size() );
+	} ) );
+
+	CHECK( !launch( 3, []( Communicator& group ) {
+		std::vector<double> v(1000);
+		if ( group.rank() == 2 )
+			_exit(3);
+
+		group.allreduce( v.data(), v.size() );
+	} ) );
+
+	CHECK( launch( 1, []( Communicator& group ) {
+		double x = 1;
+		group.allreduce( &x, 1 );
+		REQUIRE( x == 1 && group.size() == 1 );
+	} ) );
+
+	CHECK_THROWS( SharedMemoryRing::create( "/machine.test", 0 ), std::invalid_argument );
+	CHECK_THROWS( SharedMemoryRing( "/machine.no-such-group", 0 ), std::runtime_error );
+}
+
+int main ()
+{
+	trainsShards();
+	reducesUnevenLengths();
+	abortsOnFailure();
+
+	return CHECK_RESULT();
+}
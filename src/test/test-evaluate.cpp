@@ -0,0 +1,143 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "check.h"
+#include "classifier.h"
+#include "network.h"
+#include "threadpool.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// a dataset of 'n' samples with one-hot targets
+static void dataset ( int n, int inputs, int outputs, std::vector<std::vector<double> >& x, std::vector<std::vector<double> >& y )
+{
+	for (int s = 0; s < n; ++s)
+	{
+		x.push_back( input( inputs, 0.37 * s ) );
+		y.push_back( std::vector<double>( outputs, 0 ) );
+		y.back()[ ( s * 7 ) % outputs ] = 1;
+	}
+}
+
+// evaluate scores the dataset as scoring each sample's feedForward one at a time does
+static void matchesFeedForward ( Network& net, const std::vector<std::vector<double> >& x, const std::vector<std::vector<double> >& y, int batch )
+{
+	const int outputs = net.outputs();
+	double squared = 0, entropy = 0;
+	long correct = 0;
+	std::vector<std::vector<long> > confusion( outputs, std::vector<long>( outputs ) );
+
+	for (size_t s = 0; s < x.size(); ++s)
+	{
+		const std::vector<double> out = net.feedForward( x[s] );
+		const double* target = y[s].data();
+		std::vector<double> p( outputs );
+
+		if ( net.softmaxOutput() )
+		{
+			softmax( out.data(), outputs, p.data() );
+			const size_t actual = argmax( target, outputs );
+			entropy += softmaxCrossEntropy( out.data(), outputs, actual, nullptr );
+		}
+		else
+			for (int i = 0; i < outputs; ++i)
+			{
+				p[i] = out[i];
+				entropy -= target[i] * std::log( out[i] ) + ( 1 - target[i] ) * std::log( 1 - out[i] );
+			}
+
+		for (int i = 0; i < outputs; ++i)
+			squared += ( p[i] - target[i] ) * ( p[i] - target[i] );
+
+		const size_t actual = argmax( target, outputs ), predicted = argmax( out.data(), outputs );
+		correct += actual == predicted;
+		++confusion[actual][predicted];
+	}
+
+	const Network::Metrics m = net.evaluate( x, y, batch );
+	const double n = x.size();
+
+	CHECK( m.samples == (int)x.size() );
+	CHECK_NEAR( m.mse, squared / ( n * outputs ), 1e-12 );
+	CHECK_NEAR( m.crossEntropy, entropy / n, 1e-12 );
+	CHECK( m.accuracy == correct / n );
+	CHECK( m.confusion == confusion );
+}
+
+// squashed outputs are scored with the binary cross-entropy of each one
+static void scoresSigmoidOutputs ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 12, 16, 5 } ).seed(6);
+	Network net(&p);
+
+	std::vector<std::vector<double> > x, y;
+	dataset( 50, 12, 5, x, y );
+	matchesFeedForward( net, x, y, 8 );
+}
+
+// logits are scored as the probabilities softmax gives them
+static void scoresLogits ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 12, 16, 4 } ).softmaxOutput(true).seed(6);
+	Network net(&p);
+
+	std::vector<std::vector<double> > x, y;
+	dataset( 50, 12, 4, x, y );
+	matchesFeedForward( net, x, y, 7 );
+}
+
+// each chunk of the evaluation runs Parallel kernels, which run parallel loops of their own on the same pool
+static void nestsParallelKernels ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 256, 256, 64, 4 } ).softmaxOutput(true).seed(2);
+	Network net(&p);
+
+	CHECK( ThreadPool::global().size() > 0 );
+	CHECK( net.begin()->kernel == Network::Layer::Parallel );
+
+	std::vector<std::vector<double> > x, y;
+	dataset( 40, 256, 4, x, y );
+	matchesFeedForward( net, x, y, 4 );
+}
+
+int main ()
+{
+	// give the global pool workers, whatever the machine
+	setenv( "MACHINE_THREADS", "4", 1 );
+
+	scoresSigmoidOutputs();
+	scoresLogits();
+	nestsParallelKernels();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,148 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::string exported ( std::vector<unsigned int> sizes )
+{
+	Network::Parameters p;
+	p.layerSizes( sizes ).seed(1);
+	Network net(&p);
+
+	std::ostringstream os;
+	net.exportHeader( os, "test" );
+	return os.str();
+}
+
+// the generated forward pass declares only the scratch buffers it uses, each as wide as its widest layer
+static void declaresOnlyTheUsedBuffers ()
+{
+	const std::string one = exported( std::vector<unsigned int>{ 8, 3 } );
+	CHECK( one.find("double a[") == std::string::npos );
+	CHECK( one.find("double b[") == std::string::npos );
+
+	const std::string two = exported( std::vector<unsigned int>{ 8, 5, 3 } );
+	CHECK( two.find("double a[5];") != std::string::npos );
+	CHECK( two.find("double b[") == std::string::npos );
+	CHECK( two.find(" b[j]") == std::string::npos );
+
+	const std::string three = exported( std::vector<unsigned int>{ 8, 5, 7, 3 } );
+	CHECK( three.find("double a[5];") != std::string::npos );
+	CHECK( three.find("double b[7];") != std::string::npos );
+}
+
+/**
+ * build the exported header into a program that runs 'forward' over 'samples' and prints the outputs,
+ * run it, and read them back
+ *
+ * :param flags - compiler flags for the program
+ * :return - whether it built and ran
+ */
+static bool runExported ( Network& net, const std::vector<std::vector<double> >& samples, std::string flags, std::vector<double>& outputs )
+{
+	const std::string header = "test-export-model.h", source = "test-export-main.cpp", program = "test-export-main", results = "test-export-main.txt";
+	net.exportHeader( header, "model" );
+
+	std::ofstream main( source );
+	main << "#include <cstdio>\n#include \"" << header << "\"\n\n"
+	     << "static const double samples[" << samples.size() << "][model::inputs] = {\n";
+
+	char number[32];
+	for (size_t s = 0; s < samples.size(); ++s)
+	{
+		main << "\t{";
+		for (size_t i = 0; i < samples[s].size(); ++i)
+		{
+			std::snprintf( number, sizeof(number), "%.17g", samples[s][i] );
+			main << " " << number << ",";
+		}
+		main << " },\n";
+	}
+
+	main << "};\n\n"
+	     << "int main ()\n{\n"
+	     << "\tdouble out[model::outputs];\n"
+	     << "\tfor (int s = 0; s < " << samples.size() << "; ++s)\n\t{\n"
+	     << "\t\tmodel::forward( samples[s], out );\n"
+	     << "\t\tfor (int i = 0; i < model::outputs; ++i)\n"
+	     << "\t\t\tstd::printf( \"%.17g\\n\", out[i] );\n"
+	     << "\t}\n\treturn 0;\n}\n";
+	main.close();
+
+	const char* cxx = std::getenv("CXX");
+	const std::string build = std::string( cxx ? cxx : "g++" ) + " " + flags + " " + source + " -o " + program;
+	const bool ran = std::system( build.c_str() ) == 0 && std::system( ( "./" + program + " > " + results ).c_str() ) == 0;
+
+	outputs.clear();
+	std::ifstream in( results );
+	for (double x; in >> x; )
+		outputs.push_back(x);
+
+	std::remove( header.c_str() );
+	std::remove( source.c_str() );
+	std::remove( program.c_str() );
+	std::remove( results.c_str() );
+	return ran;
+}
+
+// compiled, the exported forward pass gives the outputs Network::feedForward does
+static void compilesToFeedForward ( bool softmax, std::string flags )
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 12, 9, 7, 4 } ).softmaxOutput( softmax ).seed(3);
+	Network net(&p);
+
+	std::vector<std::vector<double> > samples;
+	for (int s = 0; s < 6; ++s)
+	{
+		samples.push_back( std::vector<double>(12) );
+		for (int i = 0; i < 12; ++i)
+			samples.back()[i] = std::sin( 0.7 * s + i );
+	}
+
+	std::vector<double> outputs;
+	CHECK( runExported( net, samples, flags, outputs ) );
+	CHECK( outputs.size() == samples.size() * 4 );
+
+	for (size_t s = 0; s < samples.size() && ( s + 1 ) * 4 <= outputs.size(); ++s)
+	{
+		const std::vector<double> expected = net.feedForward( samples[s] );
+		for (size_t i = 0; i < expected.size(); ++i)
+			CHECK_NEAR( outputs[ s * 4 + i ], expected[i], 1e-12 );
+	}
+}
+
+int main ()
+{
+	declaresOnlyTheUsedBuffers();
+
+	// the fused multiply-adds of -march=native change the last few bits, hence the tolerance
+	compilesToFeedForward( false, "-std=c++11 -O2" );
+	compilesToFeedForward( true, "-std=gnu++11 -O2 -march=native" );
+
+	return CHECK_RESULT();
+}
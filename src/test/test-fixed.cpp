@@ -0,0 +1,80 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "fixed.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// a fixed copy gives the network's outputs bit for bit, whether it's on the stack or the heap
+static void matchesTheNetwork ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 16, 32, 8, 4 } ).activation(hyperbolic_tan).seed(10);
+	Network net(&p);
+
+	typedef FixedNetwork<fixed::HyperbolicTan, 16, 32, 8, 4> Fixed;
+	Fixed local(net);
+	std::unique_ptr<Fixed> heap( new Fixed(net) );
+	CHECK( (uintptr_t)heap.get() % alignof(Fixed) == 0 );
+
+	for (int i = 0; i < 20; ++i)
+	{
+		const std::vector<double> x = input( 16, i );
+		CHECK( local.feedForward(x) == net.feedForward(x) );
+		CHECK( heap->feedForward(x) == net.feedForward(x) );
+	}
+}
+
+static void rejectsOtherNetworks ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 16, 32, 4 } ).seed(11);
+	Network net(&p);
+
+	CHECK_THROWS( ( FixedNetwork<fixed::HyperbolicTan, 16, 32, 4>( net ) ), std::invalid_argument );
+	CHECK_THROWS( ( FixedNetwork<fixed::Sigmoid, 16, 8, 4>( net ) ), std::invalid_argument );
+	CHECK_THROWS( ( FixedNetwork<fixed::Sigmoid, 16, 4>( net ) ), std::invalid_argument );
+
+	Network::Parameters q(p);
+	q.softmaxOutput(true);
+	Network logits(&q);
+	CHECK_THROWS( ( FixedNetwork<fixed::Sigmoid, 16, 32, 4>( logits ) ), std::invalid_argument );
+}
+
+int main ()
+{
+	matchesTheNetwork();
+	rejectsOtherNetworks();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,83 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "holder.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// a published snapshot answers like the network it was taken from, and stays put while that one trains on
+static void servesSnapshots ()
+{
+	Network::Parameters p;
+	p.inputs(8).outputs(3).hiddenLayers(1).hiddenSize(16).seed(3);
+	Network net(&p);
+	ModelHolder holder( net.snapshot() );
+
+	const std::vector<double> x = input( 8, 0.25 );
+	for (int i = 0; i < 10; ++i)
+	{
+		net.train( input( 8, i ), std::vector<double>{ 1, 0, 0 } );
+		const std::vector<double> expected = net.feedForward(x);
+		CHECK( holder.publish( net.snapshot() ) == (unsigned long long)i + 2 );
+
+		ModelHolder::Reader reader(holder);
+		CHECK( reader->feedForward(x) == expected );
+
+		net.train( x, std::vector<double>{ 0, 1, 0 } );
+		CHECK( net.feedForward(x) != expected );
+		CHECK( reader->feedForward(x) == expected );
+	}
+}
+
+// a pruned layer keeps its sparse kernel in the snapshot
+static void keepsSparseKernels ()
+{
+	Network::Parameters p;
+	p.inputs(64).outputs(4).hiddenLayers(1).hiddenSize(64).seed(4);
+	Network net(&p);
+	net.pruneToSparsity( 0.95 );
+
+	Network* copy = net.snapshot();
+	const Network::MemoryUsage original = net.memory(), snapshot = copy->memory();
+	CHECK( original.copies > 0 );
+	CHECK( snapshot.copies == original.copies );
+
+	const std::vector<double> x = input( 64, 0.5 );
+	CHECK( copy->feedForward(x) == net.feedForward(x) );
+	delete copy;
+}
+
+int main ()
+{
+	servesSnapshots();
+	keepsSparseKernels();
+
+	return CHECK_RESULT();
+}
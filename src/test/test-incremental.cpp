@@ -0,0 +1,92 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "incremental.h"
+#include "network.h"
+
+using namespace machine;
+
+static double maxDifference ( const std::vector<double>& a, const std::vector<double>& b )
+{
+	double worst = a.size() == b.size() ? 0 : INFINITY;
+	for (size_t i = 0; i < a.size() && i < b.size(); ++i)
+		worst = std::max( worst, std::fabs( a[i] - b[i] ) );
+
+	return worst;
+}
+
+// updated scores track a full feedForward of the edited input
+static void tracksFeedForward ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 64, 32, 4 } ).initialization(xavier).seed(3);
+	Network net(&p);
+	IncrementalSession session( net, 16 );
+
+	std::vector<double> x(64);
+	for (int j = 0; j < 64; ++j)
+		x[j] = std::sin( 0.3 * j );
+
+	CHECK( session.evaluate(x) == net.feedForward(x) );
+	CHECK_THROWS( session.update( 64, 1.0 ), std::out_of_range );
+
+	for (int i = 0; i < 100; ++i)
+	{
+		const int j = ( i * 7 ) % 64;
+		x[j] = std::cos( i );
+		session.update( j, x[j] );
+
+		CHECK( session.input() == x );
+		CHECK( maxDifference( session.output(), net.feedForward(x) ) < 1e-12 );
+	}
+}
+
+// after neurons are removed from the first layer, the next update recomputes at the new width
+static void followsRemovedNeurons ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 64, 32, 4 } ).initialization(xavier).seed(4);
+	Network net(&p);
+	IncrementalSession session(net);
+
+	std::vector<double> x(64, 0.25);
+	session.evaluate(x);
+
+	std::vector<int> neurons;
+	for (int i = 8; i < 32; ++i)
+		neurons.push_back(i);
+
+	net.removeNeurons( 0, neurons );
+	CHECK( net.begin()->size() == 8 );
+
+	x[5] = -1;
+	CHECK( session.update( 5, -1 ) == net.feedForward(x) );
+
+	x[9] = 2;
+	CHECK( maxDifference( session.update( 9, 2 ), net.feedForward(x) ) < 1e-12 );
+}
+
+int main ()
+{
+	tracksFeedForward();
+	followsRemovedNeurons();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,61 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+// the two doubles made from one 128 bit block of the generator, as initializeBlock makes them
+static double fromBits ( uint32_t hi, uint32_t lo )
+{
+	return ( ( hi >> 5 ) * 67108864.0 + ( lo >> 6 ) ) / 9007199254740992.0;
+}
+
+// the first weights of layer 0 under seed 0 come from the Philox4x32-10 block of a zero counter and key,
+// which is 6627e8d5 e169c58d bc57ac4c 9b00dbd8 in the authors' known-answer tests
+static void matchesThePhiloxKnownAnswer ()
+{
+	std::vector<double> w(4);
+	initializeBlock( w.data(), 1, 4, 0, 1, 0, 0, uniform );
+
+	CHECK( w[0] == fromBits( 0x6627e8d5, 0xe169c58d ) );
+	CHECK( w[1] == fromBits( 0xbc57ac4c, 0x9b00dbd8 ) );
+}
+
+// a block of rows is filled the same way on its own as in the whole layer
+static void rowsAreIndependent ()
+{
+	const int rows = 9, cols = 21;
+	std::vector<double> whole( rows * cols ), parts( rows * cols );
+
+	initializeBlock( whole.data(), rows, cols, 0, rows, 2, 0x123456789abcdefULL, xavier );
+	initializeBlock( parts.data(), rows, cols, 5, rows, 2, 0x123456789abcdefULL, xavier );
+	initializeBlock( parts.data(), rows, cols, 0, 5, 2, 0x123456789abcdefULL, xavier );
+
+	CHECK( whole == parts );
+}
+
+int main ()
+{
+	matchesThePhiloxKnownAnswer();
+	rowsAreIndependent();
+
+	return CHECK_RESULT();
+}
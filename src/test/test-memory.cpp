@@ -0,0 +1,85 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// what estimate works out for 'params' is what a network built from them holds after a step of 'batch' samples
+static void matchesTrainedNetwork ( Network::Parameters& p, int batch )
+{
+	p.layerSizes( std::vector<unsigned int>{ 20, 32, 24, 24, 16, 5 } ).seed(5).batchSize( batch );
+	const Network::MemoryUsage estimated = Network::estimate( p, batch );
+
+	Network net(&p);
+	net.train( input( 20 * batch, 0.1 ), input( 5 * batch, 0.7 ) );
+	const Network::MemoryUsage used = net.memory();
+
+	CHECK( estimated.layers.size() == used.layers.size() );
+	for (size_t i = 0; i < estimated.layers.size() && i < used.layers.size(); ++i)
+	{
+		CHECK( estimated.layers[i].layer == used.layers[i].layer );
+		CHECK( estimated.layers[i].weights == used.layers[i].weights );
+		CHECK( estimated.layers[i].gradient == used.layers[i].gradient );
+		CHECK( estimated.layers[i].optimizer == used.layers[i].optimizer );
+		CHECK( estimated.layers[i].copies == used.layers[i].copies );
+		CHECK( estimated.layers[i].activations == used.layers[i].activations );
+	}
+
+	CHECK( estimated.activations == used.activations );
+	CHECK( estimated.scratch == used.scratch );
+	CHECK( estimated.total == used.total );
+}
+
+// the default batch is the one in the parameters
+static void defaultsToParameterBatch ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 20, 32, 5 } ).batchSize(6);
+	CHECK( Network::estimate( p ).total == Network::estimate( p, 6 ).total );
+	CHECK( Network::estimate( p, 12 ).activations == 2 * Network::estimate( p, 6 ).activations );
+}
+
+int main ()
+{
+	for (int k = 1; k <= 3; ++k)
+	{
+		Network::Parameters plain;
+		matchesTrainedNetwork( plain.checkpointInterval(k), 4 );
+
+		Network::Parameters adam;
+		matchesTrainedNetwork( adam.checkpointInterval(k).training( machine::adam ), 3 );
+
+		Network::Parameters mixed;
+		matchesTrainedNetwork( mixed.checkpointInterval(k).mixedPrecision( true ).training( momentum ), 4 );
+	}
+
+	defaultsToParameterBatch();
+
+	return CHECK_RESULT();
+}
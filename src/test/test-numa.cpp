@@ -0,0 +1,90 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// the node-split forward pass, gradient and update give exactly what the plain kernels do
+static void matchesThePlainKernels ( train_handle optimizer, bool mixed )
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 40, 96, 80, 6 } ).rate(0.05).seed(3).training( optimizer ).mixedPrecision( mixed );
+	Network plain(&p);
+
+	Network::Parameters q(p);
+	q.numa(true);
+	Network placed(&q);
+
+	// the layers are too small for the Parallel kernel (and there may be no workers), so force it
+	for (auto it = plain.begin(); it != plain.end(); ++it)
+		it->kernel = Network::Layer::Parallel;
+	for (auto it = placed.begin(); it != placed.end(); ++it)
+		it->kernel = Network::Layer::Parallel;
+
+	for (int i = 0; i < 10; ++i)
+	{
+		plain.train( input( 40, i ), input( 6, -i ) );
+		placed.train( input( 40, i ), input( 6, -i ) );
+	}
+
+	CHECK( placed.placement().enabled );
+	CHECK( placed.placement().layers.size() == 3 );
+
+	auto other = plain.begin();
+	for (auto it = placed.begin(); it != placed.end(); ++it, ++other)
+		CHECK( it->weights == other->weights );
+
+	for (int i = 0; i < 5; ++i)
+		CHECK( placed.feedForward( input( 40, 0.5 + i ) ) == plain.feedForward( input( 40, 0.5 + i ) ) );
+}
+
+// a snapshot runs on the original's pool, placed the same way
+static void snapshotsShareThePlacement ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 40, 96, 6 } ).seed(5).numa(true);
+	Network net(&p);
+
+	std::unique_ptr<Network> copy( net.snapshot() );
+	CHECK( copy->placement().enabled );
+	CHECK( copy->placement().workerCpu == net.placement().workerCpu );
+	CHECK( copy->feedForward( input( 40, 1 ) ) == net.feedForward( input( 40, 1 ) ) );
+}
+
+int main ()
+{
+	matchesThePlainKernels( backPropogation, false );
+	matchesThePlainKernels( adam, false );
+	matchesThePlainKernels( momentum, true );
+	snapshotsShareThePlacement();
+
+	return CHECK_RESULT();
+}
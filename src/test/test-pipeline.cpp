@@ -0,0 +1,132 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+#include "pipeline.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// the stages cover every layer once, in order
+static void checkStages ( const LayerPipeline& pipeline, int layers, int most )
+{
+	const std::vector<LayerPipeline::Stage> stages = pipeline.stages();
+	CHECK( !stages.empty() && (int)stages.size() <= most );
+
+	int next = 0;
+	for (auto it = stages.begin(); it != stages.end(); ++it)
+	{
+		CHECK( it->first == next && it->last >= it->first );
+		next = it->last + 1;
+	}
+
+	CHECK( next == layers );
+}
+
+// the outputs come out in the order the inputs went in, the same as feedForward's
+static void matchesFeedForward ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 16, 24, 20, 18, 5 } ).seed(5);
+	Network net(&p);
+
+	std::vector<std::vector<double> > inputs, expected;
+	for (int s = 0; s < 20; ++s)
+	{
+		inputs.push_back( input( 16, 0.3 * s ) );
+		expected.push_back( net.feedForward( inputs.back() ) );
+	}
+
+	LayerPipeline pipeline( net, 3, 8 );
+	checkStages( pipeline, 4, 3 );
+
+	CHECK( pipeline.run( inputs ) == expected );
+	CHECK( pipeline.inFlight() == 0 );
+
+	const std::vector<LayerPipeline::Stage> stages = pipeline.stages();
+	for (auto it = stages.begin(); it != stages.end(); ++it)
+		CHECK( it->samples == 20 );
+
+	// one at a time, through push and pop
+	std::vector<double> out;
+	CHECK( pipeline.push( inputs[0] ) && pipeline.push( inputs[1] ) );
+	CHECK( pipeline.inFlight() == 2 );
+	CHECK_THROWS( pipeline.rebalance(), std::logic_error );
+
+	for (int s = 0; s < 2; ++s)
+	{
+		while ( !pipeline.pop(out) )
+			std::this_thread::yield();
+		CHECK( out == expected[s] );
+	}
+
+	// with nothing in flight, the layers can be divided again by the times they've taken
+	pipeline.rebalance();
+	checkStages( pipeline, 4, 3 );
+	CHECK( pipeline.run( inputs ) == expected );
+}
+
+// no more than 'depth' samples are let in at once
+static void holdsBackPastTheDepth ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 8, 6, 4 } ).seed(5);
+	Network net(&p);
+
+	std::vector<std::vector<double> > expected;
+	for (int s = 0; s < 3; ++s)
+		expected.push_back( net.feedForward( input( 8, s ) ) );
+
+	LayerPipeline pipeline( net, 2, 2 );
+	CHECK( pipeline.push( input( 8, 0 ) ) );
+	CHECK( pipeline.push( input( 8, 1 ) ) );
+	CHECK( !pipeline.push( input( 8, 2 ) ) );
+
+	std::vector<double> out;
+	while ( !pipeline.pop(out) )
+		std::this_thread::yield();
+	CHECK( out == expected[0] );
+	CHECK( pipeline.push( input( 8, 2 ) ) );
+
+	for (int s = 1; s < 3; ++s)
+	{
+		while ( !pipeline.pop(out) )
+			std::this_thread::yield();
+		CHECK( out == expected[s] );
+	}
+}
+
+int main ()
+{
+	matchesFeedForward();
+	holdsBackPastTheDepth();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,147 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// a layer on the sparse kernel keeps its sparsity pattern through training, and its sparse copy keeps up with the weights
+static void staysPrunedThroughTraining ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 64, 64, 8 } ).rate(0.1).seed(12);
+	Network net(&p);
+
+	// whether a layer is converted depends on timing; make sure both are
+	net.pruneToSparsity( 0.9 );
+	for (auto it = net.begin(); it != net.end(); ++it)
+		if ( it->kernel != Network::Layer::Sparse )
+			it->sparsify();
+
+	std::vector<std::vector<double> > before;
+	for (auto it = net.begin(); it != net.end(); ++it)
+		before.push_back( it->weights );
+
+	for (int i = 0; i < 20; ++i)
+		net.train( input( 64, i ), input( 8, -i ) );
+
+	Network::Parameters q(p);
+	Network dense(&q);
+
+	size_t l = 0;
+	auto copy = dense.begin();
+	for (auto it = net.begin(); it != net.end(); ++it, ++copy, ++l)
+	{
+		CHECK( it->kernel == Network::Layer::Sparse );
+		CHECK( it->weights != before[l] );
+
+		for (size_t i = 0; i < it->weights.size(); ++i)
+			if ( before[l][i] == 0 )
+				CHECK( it->weights[i] == 0 );
+
+		copy->weights = it->weights;
+	}
+
+	for (int i = 0; i < 5; ++i)
+		CHECK( net.feedForward( input( 64, 0.5 + i ) ) == dense.feedForward( input( 64, 0.5 + i ) ) );
+}
+
+// layer 'l' of a network
+static Network::Layer& layer ( Network& net, int l )
+{
+	auto it = net.begin();
+	while ( l-- > 0 )
+		++it;
+
+	return *it;
+}
+
+// pruning one layer, or removing neurons from another, leaves the layers that weren't touched on the sparse kernel
+static void leavesOtherLayersSparse ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 64, 64, 48, 32, 8 } ).seed(4);
+	Network net(&p);
+
+	net.pruneToSparsity( 0.9, std::vector<int>{ 0, 1 } );
+	for (int l = 0; l < 2; ++l)
+		if ( layer( net, l ).kernel != Network::Layer::Sparse )
+			layer( net, l ).sparsify();
+
+	net.prune( 0.05, std::vector<int>{ 1 } );
+	CHECK( layer( net, 0 ).kernel == Network::Layer::Sparse );
+
+	if ( layer( net, 1 ).kernel != Network::Layer::Sparse )
+		layer( net, 1 ).sparsify();
+
+	net.removeNeurons( 2, std::vector<int>{ 0, 5, 9 } );
+	CHECK( layer( net, 0 ).kernel == Network::Layer::Sparse );
+	CHECK( layer( net, 1 ).kernel == Network::Layer::Sparse );
+	CHECK( layer( net, 2 ).size() == 29 );
+}
+
+// shrink runs its forward passes out of training mode, and leaves the network in the mode it found it in
+static void keepsTrainingMode ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 16, 24, 12, 4 } ).seed(8);
+	Network net(&p);
+
+	std::vector<std::vector<double> > inputs, targets;
+	for (int i = 0; i < 8; ++i)
+	{
+		inputs.push_back( input( 16, i ) );
+		targets.push_back( input( 4, -i ) );
+	}
+
+	net.toggleTrainingMode();
+	const std::vector<Network::ShrinkReport> reports = net.shrink( 0.5, 2, inputs, targets, Network::MeanActivation );
+	CHECK( reports.size() == 3 );
+	CHECK( net.trainingMode() );
+	CHECK( layer( net, 0 ).size() == 12 );
+
+	net.toggleTrainingMode();
+	net.shrink( 0.25, 1, inputs, targets );
+	CHECK( !net.trainingMode() );
+
+	// and when a step throws
+	net.toggleTrainingMode();
+	inputs.back().resize(3);
+	CHECK_THROWS( net.shrink( 0.25, 1, inputs, targets ), std::exception );
+	CHECK( net.trainingMode() );
+}
+
+int main ()
+{
+	staysPrunedThroughTraining();
+	leavesOtherLayersSparse();
+	keepsTrainingMode();
+
+	return CHECK_RESULT();
+}
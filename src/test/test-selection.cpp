@@ -0,0 +1,93 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+#include "selection.h"
+
+using namespace machine;
+
+static std::vector<double> input ( int n, double phase )
+{
+	std::vector<double> x(n);
+	for (int j = 0; j < n; ++j)
+		x[j] = std::sin( phase + j );
+
+	return x;
+}
+
+// the selected outputs come out bit for bit as feedForward's
+static void matchesFeedForward ( Network& net, OutputSelection& selection )
+{
+	for (int s = 0; s < 5; ++s)
+	{
+		const std::vector<double> x = input( net.inputs(), 0.7 * s );
+		const std::vector<double> full = net.feedForward(x);
+		const std::vector<double>& some = selection.evaluate(x);
+
+		CHECK( some.size() == selection.outputs().size() );
+		for (size_t k = 0; k < some.size(); ++k)
+			CHECK( some[k] == full[ selection.outputs()[k] ] );
+	}
+}
+
+// in a dense network every hidden neuron is needed
+static void evaluatesDenseNetworks ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 10, 16, 12, 5 } ).seed(3);
+	Network net(&p);
+
+	OutputSelection selection( net, std::vector<int>{ 3, 1 } );
+	CHECK( selection.neurons() == 16 + 12 + 2 );
+	matchesFeedForward( net, selection );
+}
+
+// after pruning, only the cone of the selected outputs is computed, and it's worked out again when the weights change
+static void evaluatesPrunedNetworks ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 40, 48, 32, 6 } ).seed(3);
+	Network net(&p);
+
+	net.pruneToSparsity( 0.9 );
+	for (auto it = net.begin(); it != net.end(); ++it)
+		if ( it->kernel != Network::Layer::Sparse )
+			it->sparsify();
+
+	OutputSelection selection( net, std::vector<int>{ 4 } );
+	const int before = selection.neurons();
+	CHECK( before < 48 + 32 + 1 );
+	matchesFeedForward( net, selection );
+
+	// a harder pruning shrinks the cone once the selection sees the new version
+	net.pruneToSparsity( 0.97 );
+	CHECK( selection.neurons() == before );
+	matchesFeedForward( net, selection );
+	CHECK( selection.neurons() < before );
+	CHECK( selection.neurons() == OutputSelection( net, std::vector<int>{ 4 } ).neurons() );
+}
+
+int main ()
+{
+	evaluatesDenseNetworks();
+	evaluatesPrunedNetworks();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,174 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+#include "telemetry.h"
+
+using namespace machine;
+
+static TrainingRecord record ( unsigned long long step )
+{
+	TrainingRecord r;
+	r.step = step;
+	r.batch = 4;
+	r.loss = 0.25 * step;
+	r.samplesPerSecond = 1000;
+	r.rate = 0.01;
+	r.gradientNorm = step % 2 ? 1.5 : std::nan("");
+	r.seconds = 0.004;
+	return r;
+}
+
+// the value of 'key' in an NDJSON line, or NaN for null
+static double field ( const std::string& line, const std::string& key )
+{
+	const size_t at = line.find( "\"" + key + "\":" );
+	if ( at == std::string::npos )
+		return -1;
+
+	const std::string value = line.substr( at + key.size() + 3 );
+	return value.compare( 0, 4, "null" ) == 0 ? std::nan("") : std::stod( value );
+}
+
+static std::vector<std::string> lines ( const std::string& file )
+{
+	std::ifstream in( file );
+	std::vector<std::string> all;
+	for (std::string line; std::getline( in, line ); )
+		all.push_back( line );
+
+	return all;
+}
+
+// every record is written, one per line, in order, with NaN as null
+static void writesNdjson ()
+{
+	const std::string file = "test-telemetry.ndjson";
+	{
+		Telemetry t( file, Telemetry::NDJSON );
+		for (unsigned long long s = 1; s <= 10; ++s)
+			CHECK( t.record( record(s) ) );
+		t.flush();
+	}
+
+	const std::vector<std::string> all = lines( file );
+	CHECK( all.size() == 10 );
+	for (size_t i = 0; i < all.size(); ++i)
+	{
+		CHECK( all[i].front() == '{' && all[i].back() == '}' );
+		CHECK( field( all[i], "step" ) == i + 1 );
+		CHECK( field( all[i], "batch" ) == 4 );
+		CHECK_NEAR( field( all[i], "loss" ), 0.25 * ( i + 1 ), 1e-9 );
+		CHECK( ( i % 2 == 0 ) == !std::isnan( field( all[i], "gradient_norm" ) ) );
+	}
+
+	std::remove( file.c_str() );
+}
+
+// a '.csv' file gets a header, then one row of the same columns per record
+static void writesCsv ()
+{
+	const std::string file = "test-telemetry.csv";
+	CHECK( Telemetry::formatOf( file ) == Telemetry::CSV );
+	CHECK( Telemetry::formatOf( "test-telemetry.ndjson" ) == Telemetry::NDJSON );
+	{
+		Telemetry t( file, Telemetry::formatOf( file ) );
+		for (unsigned long long s = 1; s <= 10; ++s)
+			t.record( record(s) );
+	}
+
+	// the destructor writes out what is still queued
+	const std::vector<std::string> all = lines( file );
+	CHECK( all.size() == 11 );
+	CHECK( all[0] == "step,batch,loss,samples_per_second,rate,gradient_norm,seconds" );
+	for (size_t i = 1; i < all.size(); ++i)
+	{
+		unsigned long long step;
+		int batch;
+		double loss;
+		CHECK( std::sscanf( all[i].c_str(), "%llu,%d,%lf,", &step, &batch, &loss ) == 3 );
+		CHECK( step == i && batch == 4 );
+		CHECK_NEAR( loss, 0.25 * i, 1e-9 );
+	}
+
+	std::remove( file.c_str() );
+}
+
+// a full ring drops records rather than blocking, and counts what it dropped
+static void dropsWhenFull ()
+{
+	const int pushed = 20000;
+	Telemetry t( "", Telemetry::NDJSON, 100, 2 );
+
+	int accepted = 0;
+	for (int s = 1; s <= pushed; ++s)
+		accepted += t.record( record(s) );
+	t.flush();
+
+	const Telemetry::Aggregates a = t.aggregates();
+	CHECK( a.dropped > 0 );
+	CHECK( a.steps == (unsigned long long)accepted );
+	CHECK( a.steps + a.dropped == (unsigned long long)pushed );
+}
+
+// the loss recorded for a step is half its squared error, averaged over the batch
+static void recordsTrainingLoss ()
+{
+	const std::string file = "test-telemetry-loss.ndjson";
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 6, 8, 3 } ).seed(4).telemetry( file );
+	Network net(&p);
+
+	const int batch = 4;
+	std::vector<double> in, expected;
+	for (int i = 0; i < 6 * batch; ++i)
+		in.push_back( std::sin( 0.3 * i ) );
+	for (int i = 0; i < 3 * batch; ++i)
+		expected.push_back( std::cos( 0.7 * i ) );
+
+	const std::vector<double> out = net.train( in, expected );
+	net.telemetry()->flush();
+
+	double loss = 0;
+	for (size_t i = 0; i < out.size(); ++i)
+		loss += 0.5 * ( out[i] - expected[i] ) * ( out[i] - expected[i] );
+
+	const std::vector<std::string> all = lines( file );
+	CHECK( all.size() == 1 );
+	if ( !all.empty() )
+	{
+		CHECK( field( all[0], "batch" ) == batch );
+		CHECK_NEAR( field( all[0], "loss" ), loss / batch, 1e-6 );
+	}
+
+	std::remove( file.c_str() );
+}
+
+int main ()
+{
+	writesNdjson();
+	writesCsv();
+	dropsWhenFull();
+	recordsTrainingLoss();
+
+	return CHECK_RESULT();
+}
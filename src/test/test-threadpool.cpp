@@ -0,0 +1,129 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "threadpool.h"
+
+using namespace machine;
+
+// a thread waiting on its parallelFor only runs that loop's chunks, never a task queued by someone else
+static void leavesOtherTasksToTheWorkers ()
+{
+	ThreadPool pool(1);
+	std::mutex mutex;
+	std::condition_variable released;
+	bool release = false;
+	std::atomic<bool> busy(false);
+
+	// keep the only worker busy, so everything queued after this waits
+	pool.enqueue( [&]{
+		busy = true;
+		std::unique_lock<std::mutex> lock(mutex);
+		released.wait( lock, [&]{ return release; } );
+	});
+	while ( !busy )
+		std::this_thread::yield();
+
+	std::promise<std::thread::id> other;
+	std::future<std::thread::id> ran = other.get_future();
+	pool.enqueue( [&]{ other.set_value( std::this_thread::get_id() ); } );
+
+	std::atomic<size_t> items(0);
+	pool.parallelFor( 0, 100, 1, [&]( size_t lo, size_t hi ) { items += hi - lo; } );
+	CHECK( items == 100 );
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		release = true;
+	}
+	released.notify_all();
+
+	CHECK( ran.get() != std::this_thread::get_id() );
+}
+
+// every item is visited once, however the loops are nested
+static void coversEveryItem ()
+{
+	ThreadPool pool(3);
+
+	for (int round = 0; round < 200; ++round)
+	{
+		std::vector<std::atomic<int> > visits(64);
+		for (auto it = visits.begin(); it != visits.end(); ++it)
+			*it = 0;
+
+		pool.parallelFor( 0, 8, 1, [&]( size_t lo, size_t hi ) {
+			for (size_t i = lo; i < hi; ++i)
+				pool.parallelFor( i * 8, i * 8 + 8, 2, [&]( size_t a, size_t b ) {
+					for (size_t j = a; j < b; ++j)
+						++visits[j];
+				});
+		});
+
+		for (auto it = visits.begin(); it != visits.end(); ++it)
+			CHECK( *it == 1 );
+	}
+}
+
+// a chunk that throws, on the caller or on a worker, lets the others finish and is rethrown to the caller
+static void rethrowsOnTheCaller ()
+{
+	ThreadPool pool(3);
+
+	for (size_t failing = 0; failing < 4; ++failing)
+	{
+		std::atomic<int> finished(0);
+		CHECK_THROWS( pool.parallelFor( 0, 4, 1, [&]( size_t lo, size_t ) {
+			std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+			if ( lo == failing )
+				throw std::runtime_error("a deliberate failure");
+			++finished;
+		}), std::runtime_error );
+		CHECK( finished == 3 );
+	}
+
+	// and the pool still works afterwards
+	std::atomic<size_t> items(0);
+	pool.parallelFor( 0, 1000, 10, [&]( size_t lo, size_t hi ) { items += hi - lo; } );
+	CHECK( items == 1000 );
+}
+
+static void checksWorkers ()
+{
+	ThreadPool pool(1);
+
+	CHECK_THROWS( pool.pin( 1, 0 ), std::out_of_range );
+	CHECK( !pool.pin( 0, -1 ) );
+}
+
+int main ()
+{
+	leavesOtherTasksToTheWorkers();
+	coversEveryItem();
+	rethrowsOnTheCaller();
+	checksWorkers();
+
+	return CHECK_RESULT();
+}
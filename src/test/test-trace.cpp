@@ -0,0 +1,207 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "network.h"
+#include "threadpool.h"
+#include "trace.h"
+
+using namespace machine;
+
+/**
+ * just enough of a JSON parser to check that the trace is well formed; collects the value of
+ * every "name" key along the way
+ */
+struct Json
+{
+	std::string text;
+	size_t at;
+	std::multiset<std::string> names;
+
+	Json ( const std::string& text ) : text(text), at(0) {}
+
+	void space ()
+	{
+		while ( this->at < this->text.size() && std::isspace( (unsigned char)this->text[ this->at ] ) )
+			++this->at;
+	}
+
+	bool literal ( const char* word )
+	{
+		const std::string w(word);
+		if ( this->text.compare( this->at, w.size(), w ) != 0 )
+			return false;
+
+		this->at += w.size();
+		return true;
+	}
+
+	bool string ( std::string& s )
+	{
+		if ( !this->literal("\"") )
+			return false;
+
+		s.clear();
+		while ( this->at < this->text.size() && this->text[ this->at ] != '"' )
+		{
+			if ( this->text[ this->at ] == '\\' )
+				++this->at;
+			s += this->text[ this->at++ ];
+		}
+
+		return this->literal("\"");
+	}
+
+	bool number ()
+	{
+		const char* begin = this->text.c_str() + this->at;
+		char* end;
+		std::strtod( begin, &end );
+		this->at += end - begin;
+		return end != begin;
+	}
+
+	bool value ()
+	{
+		this->space();
+		std::string s;
+		bool ok;
+
+		if ( this->literal("{") )
+		{
+			this->space();
+			ok = this->literal("}");
+			while ( !ok )
+			{
+				this->space();
+				std::string key;
+				if ( !this->string(key) )
+					return false;
+
+				this->space();
+				if ( !this->literal(":") )
+					return false;
+
+				this->space();
+				if ( key == "name" && this->string(s) )
+					this->names.insert(s);
+				else if ( !this->value() )
+					return false;
+
+				this->space();
+				ok = this->literal("}");
+				if ( !ok && !this->literal(",") )
+					return false;
+			}
+			return true;
+		}
+
+		if ( this->literal("[") )
+		{
+			this->space();
+			ok = this->literal("]");
+			while ( !ok )
+			{
+				if ( !this->value() )
+					return false;
+
+				this->space();
+				ok = this->literal("]");
+				if ( !ok && !this->literal(",") )
+					return false;
+			}
+			return true;
+		}
+
+		if ( this->text[ this->at ] == '"' )
+			return this->string(s);
+
+		return this->literal("true") || this->literal("false") || this->literal("null") || this->number();
+	}
+
+	bool parse ()
+	{
+		if ( !this->value() )
+			return false;
+
+		this->space();
+		return this->at == this->text.size();
+	}
+};
+
+// a traced training step writes valid JSON with a span for every kind of work in it
+static void writesSpans ()
+{
+	Network::Parameters p;
+	p.layerSizes( std::vector<unsigned int>{ 16, 24, 24, 24, 24, 4 } ).seed(3).batchSize(4).checkpointInterval(2);
+	Network net(&p);
+	CHECK( net.checkpointInterval() == 2 );
+
+	std::vector<double> in, expected;
+	for (int i = 0; i < 16 * 4; ++i)
+		in.push_back( std::sin( 0.2 * i ) );
+	for (int i = 0; i < 4 * 4; ++i)
+		expected.push_back( i % 4 == 0 );
+
+	// a pool of its own, so that the loop is split into chunks even on a single cpu
+	ThreadPool pool(2);
+
+	Tracer& tracer = Tracer::global();
+	tracer.start();
+	net.train( in, expected );
+	pool.parallelFor( 0, 64, 1, []( size_t, size_t ) {} );
+	CHECK( tracer.events() > 0 );
+
+	std::ostringstream out;
+	tracer.write(out);
+	CHECK( !tracer.enabled() );
+
+	Json json( out.str() );
+	CHECK( json.parse() );
+	CHECK( json.names.count("thread_name") > 0 );
+	CHECK( json.names.count("forward") == 5 + 2 );
+	CHECK( json.names.count("recompute") == 2 );
+	CHECK( json.names.count("backward") == 5 );
+	CHECK( json.names.count("update") == 5 );
+	CHECK( json.names.count("task") > 0 );
+
+	// nothing is recorded once the trace has been written out
+	const size_t events = tracer.events();
+	net.train( in, expected );
+	CHECK( tracer.events() == events );
+
+	// and starting again drops what was recorded before
+	tracer.start();
+	std::ostringstream empty;
+	tracer.write(empty);
+	Json none( empty.str() );
+	CHECK( none.parse() );
+	CHECK( none.names.count("forward") == 0 );
+}
+
+int main ()
+{
+	writesSpans();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,246 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "threadpool.h"
+#include "trace.h"
+
+namespace machine {
+
+	/**
+	 * a parallelFor in progress
+	 *
+	 * the chunks are claimed one at a time from 'next', by the caller and by any workers that take
+	 * up the loop's invitations; 'helpers' counts the workers still inside 'run', so the caller knows
+	 * when the loop (and the function it refers to) can go out of scope
+	 *
+	 * while it has invitations left, the loop is on the pool's list of open loops; the list is
+	 * threaded through the loops themselves, so opening one doesn't allocate
+	 */
+	struct ThreadPool::Loop
+	{
+		Loop ( const std::function<void(size_t, size_t)>& fn, size_t begin, size_t end, size_t step, size_t chunks )
+			: fn(fn), begin(begin), end(end), step(step), chunks(chunks), next(0), helpers(0), invitations(0), below(nullptr) {}
+
+		// run chunks until there are none left to claim, keeping the first exception any of them throws
+		void run ()
+		{
+			for (size_t c = this->next++; c < this->chunks; c = this->next++)
+			{
+				const size_t lo = this->begin + c * this->step;
+				const size_t hi = std::min( this->end, lo + this->step );
+				if ( lo >= hi )
+					continue;
+
+				try
+				{
+					TraceSpan span( "task", "pool" );
+					this->fn( lo, hi );
+				}
+				catch ( ... )
+				{
+					std::lock_guard<std::mutex> lock( this->failing );
+					if ( !this->error )
+						this->error = std::current_exception();
+				}
+			}
+		}
+
+		const std::function<void(size_t, size_t)>& fn;
+		const size_t begin;
+		const size_t end;
+		const size_t step;
+		const size_t chunks;
+		std::atomic<size_t> next;
+		std::atomic<unsigned int> helpers;
+		std::exception_ptr error;
+		std::mutex failing;
+
+		// guarded by the pool's mutex
+		unsigned int invitations;
+		Loop* below;
+	};
+
+	ThreadPool::ThreadPool ( unsigned int n ) : open(nullptr), stopping(false)
+	{
+		for (unsigned int i = 0; i < n; ++i)
+			this->workers.push_back( std::thread( &ThreadPool::work, this, i ) );
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+			this->stopping = true;
+		}
+
+		this->ready.notify_all();
+
+		for (auto it = this->workers.begin(); it != this->workers.end(); ++it)
+			it->join();
+	}
+
+	// number of threads the global pool works with, counting the caller
+	static unsigned int globalThreads ()
+	{
+		const char* threads = std::getenv( "MACHINE_THREADS" );
+		if ( threads && std::atoi(threads) > 0 )
+			return std::atoi(threads);
+
+		return std::max( 1u, std::thread::hardware_concurrency() );
+	}
+
+	ThreadPool& ThreadPool::global ()
+	{
+		static ThreadPool pool( globalThreads() - 1 );
+		return pool;
+	}
+
+	unsigned int ThreadPool::size () const
+	{
+		return this->workers.size();
+	}
+
+	void ThreadPool::enqueue ( task t )
+	{
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+			this->tasks.push_back( std::move(t) );
+		}
+
+		this->ready.notify_one();
+	}
+
+	bool ThreadPool::pin ( unsigned int worker, int cpu )
+	{
+		if ( worker >= this->workers.size() )
+			throw std::out_of_range("ThreadPool::pin: there's no worker " + std::to_string(worker));
+
+#ifdef __linux__
+		if ( cpu < 0 || cpu >= CPU_SETSIZE )
+			return false;
+
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		CPU_SET( cpu, &set );
+		return pthread_setaffinity_np( this->workers[worker].native_handle(), sizeof(set), &set ) == 0;
+#else
+		return false;
+#endif
+	}
+
+	void ThreadPool::work ( unsigned int index )
+	{
+		Tracer::global().nameThread( "pool worker " + std::to_string(index) );
+
+		for (;;)
+		{
+			task t;
+			Loop* loop = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock( this->mutex );
+				this->ready.wait( lock, [this]{ return this->stopping || this->open || !this->tasks.empty(); } );
+
+				if ( this->open )
+				{
+					loop = this->open;
+					if ( --loop->invitations == 0 )
+						this->open = loop->below;
+
+					// counted while the pool is still locked, so the caller can't miss it
+					++loop->helpers;
+				}
+				else if ( this->tasks.empty() )
+					return;
+				else
+				{
+					t = std::move( this->tasks.front() );
+					this->tasks.pop_front();
+				}
+			}
+
+			if ( !loop )
+			{
+				t();
+				continue;
+			}
+
+			loop->run();
+			--loop->helpers;
+		}
+	}
+
+	void ThreadPool::parallelFor ( size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn )
+	{
+		if ( end <= begin )
+			return;
+
+		size_t n = end - begin;
+		size_t chunks = std::min( (size_t)this->size() + 1, ( n + std::max( grain, (size_t)1 ) - 1 ) / std::max( grain, (size_t)1 ) );
+
+		if ( chunks <= 1 )
+		{
+			fn( begin, end );
+			return;
+		}
+
+		Loop loop( fn, begin, end, ( n + chunks - 1 ) / chunks, chunks );
+
+		// invite a worker per chunk beyond the caller's own
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+			loop.invitations = chunks - 1;
+			loop.below = this->open;
+			this->open = &loop;
+		}
+
+		for (size_t c = 1; c < chunks; ++c)
+			this->ready.notify_one();
+
+		loop.run();
+
+		// every chunk has been claimed: withdraw the invitations no worker took up,
+		// and wait for the workers that did to finish their chunks
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+			if ( loop.invitations > 0 )
+			{
+				Loop** link = &this->open;
+				while ( *link != &loop )
+					link = &(*link)->below;
+
+				*link = loop.below;
+				loop.invitations = 0;
+			}
+		}
+
+		while ( loop.helpers.load() > 0 )
+			std::this_thread::yield();
+
+		if ( loop.error )
+			std::rethrow_exception( loop.error );
+	}
+}
@@ -0,0 +1,95 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									Thread Pool
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * a fixed set of worker threads consuming a shared task queue
+	 *
+	 * the thread calling parallelFor works through its own loop's chunks alongside the workers
+	 * that join in, so nested parallel loops can't deadlock and a pool of n workers gives n+1 way
+	 * parallelism. It never picks up anyone else's task, which could run for any length of time
+	 * (an InferenceQueue runner, say) and hold up the loop.
+	 *
+	 */
+	class ThreadPool
+	{
+	public:
+
+		typedef std::function<void()> task;
+
+		ThreadPool ( unsigned int );
+		~ThreadPool();
+
+		// the process-wide pool used by the network kernels, with one worker per extra hardware thread,
+		// or per extra thread of MACHINE_THREADS if that's set in the environment when it's first used
+		static ThreadPool& global ();
+
+		// number of worker threads (not counting callers of parallelFor)
+		unsigned int size () const;
+
+		void enqueue ( task );
+
+		// restrict a worker to a single cpu; false if that isn't supported (or there's no such cpu),
+		// and throws std::out_of_range if there's no such worker
+		bool pin ( unsigned int, int );
+
+		/**
+		 * run fn(lo, hi) over [begin, end) split into chunks of at least 'grain' items,
+		 * and return once every chunk has finished
+		 *
+		 * a chunk that throws doesn't stop the others; once they're all done, the first
+		 * exception is rethrown on the calling thread
+		 *
+		 * the loop doesn't allocate (pass a large lambda in a std::cref, so the std::function
+		 * doesn't either); its invitations to the workers live on the caller's stack
+		 */
+		void parallelFor ( size_t, size_t, size_t, const std::function<void(size_t, size_t)>& );
+
+	private:
+
+		// the state of one parallelFor, on the caller's stack, see 'threadpool.cpp'
+		struct Loop;
+
+		void work ( unsigned int );
+
+		std::vector<std::thread> workers;
+
+		// queued tasks, and the loops that still have invitations for workers to join in, newest
+		// first (linked through Loop::below); the workers take up invitations before tasks
+		std::deque<task> tasks;
+		Loop* open;
+		std::mutex mutex;
+		std::condition_variable ready;
+		bool stopping;
+
+	}; // end class ThreadPool
+}
+
+#endif
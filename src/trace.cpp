@@ -0,0 +1,170 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+#include "trace.h"
+
+namespace machine {
+
+	Tracer::Tracer () : on(false), epoch(0) {}
+
+	Tracer& Tracer::global ()
+	{
+		static Tracer tracer;
+		return tracer;
+	}
+
+	int64_t Tracer::now ()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	void Tracer::start ()
+	{
+		std::lock_guard<std::mutex> lock( this->mutex );
+
+		for (auto it = this->buffers.begin(); it != this->buffers.end(); ++it)
+		{
+			std::lock_guard<std::mutex> buffer( (*it)->mutex );
+			(*it)->events.clear();
+		}
+
+		this->epoch = now();
+		this->on = true;
+	}
+
+	void Tracer::stop ()
+	{
+		this->on = false;
+	}
+
+	size_t Tracer::events () const
+	{
+		std::lock_guard<std::mutex> lock( this->mutex );
+		size_t n = 0;
+
+		for (auto it = this->buffers.begin(); it != this->buffers.end(); ++it)
+		{
+			std::lock_guard<std::mutex> buffer( (*it)->mutex );
+			n += (*it)->events.size();
+		}
+
+		return n;
+	}
+
+	// the calling thread's buffer, registered the first time the thread records anything
+	Tracer::Buffer& Tracer::local ()
+	{
+		static thread_local Buffer* buffer = nullptr;
+
+		if ( !buffer )
+		{
+			std::lock_guard<std::mutex> lock( this->mutex );
+
+			this->buffers.push_back( std::unique_ptr<Buffer>( new Buffer() ) );
+			buffer = this->buffers.back().get();
+			buffer->tid = this->buffers.size();
+			buffer->name = "thread " + std::to_string( buffer->tid );
+			buffer->events.reserve( 1024 );
+		}
+
+		return *buffer;
+	}
+
+	void Tracer::nameThread ( std::string name )
+	{
+		Buffer& buffer = this->local();
+		std::lock_guard<std::mutex> lock( buffer.mutex );
+		buffer.name = name;
+	}
+
+	void Tracer::record ( const char* name, const char* category, int64_t begin, int64_t end, int layer )
+	{
+		Buffer& buffer = this->local();
+		Event e = { name, category, begin, end, layer };
+
+		std::lock_guard<std::mutex> lock( buffer.mutex );
+		buffer.events.push_back(e);
+	}
+
+	void Tracer::write ( std::string file )
+	{
+		std::ofstream out( file, std::ios::out | std::ios::trunc );
+		if ( !out )
+			throw std::runtime_error("Tracer::write: couldn't open '" + file + "' for writing");
+
+		this->write(out);
+	}
+
+	/**
+	 * every span is a complete ("X") event, with its times in microseconds since 'start'; each
+	 * thread gets a metadata event with its name, so the pool's workers are labelled on the timeline
+	 */
+	void Tracer::write ( std::ostream& out )
+	{
+		this->stop();
+
+#ifdef __unix__
+		const int pid = ::getpid();
+#else
+		const int pid = 1;
+#endif
+		const int64_t epoch = this->epoch.load();
+		const char* separator = "\n";
+		char line[512];
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+		std::lock_guard<std::mutex> lock( this->mutex );
+
+		for (auto it = this->buffers.begin(); it != this->buffers.end(); ++it)
+		{
+			Buffer& buffer = **it;
+			std::lock_guard<std::mutex> events( buffer.mutex );
+
+			std::snprintf( line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				separator, pid, buffer.tid, buffer.name.c_str() );
+			out << line;
+			separator = ",\n";
+
+			for (auto e = buffer.events.begin(); e != buffer.events.end(); ++e)
+			{
+				if ( e->begin < epoch )
+					continue;
+
+				const double ts = ( e->begin - epoch ) / 1e3;
+				const double dur = ( e->end - e->begin ) / 1e3;
+
+				if ( e->layer >= 0 )
+					std::snprintf( line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"layer\":%d}}",
+						e->name, e->category, ts, dur, pid, buffer.tid, e->layer );
+				else
+					std::snprintf( line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+						e->name, e->category, ts, dur, pid, buffer.tid );
+				out << line;
+			}
+		}
+
+		out << "\n]}\n";
+	}
+}
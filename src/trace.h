@@ -0,0 +1,154 @@
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *   _   _                                  _     _
+ *  | |_| |__   ___    _ __ ___   __ _  ___| |__ (_)_ __   ___
+ *  | __| '_ \ / _ \  | '_ ` _ \ / _` |/ __| '_ \| | '_ \ / _ \
+ *  | |_| | | |  __/  | | | | | | (_| | (__| | | | | | | |  __/
+ *   \__|_| |_|\___|  |_| |_| |_|\__,_|\___|_| |_|_|_| |_|\___|
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * A machine learning experiment by @jonbrennecke / https://github.com/jonbrennecke
+ *
+ * Released under the MIT license (see the accompanying LICENSE.md)
+ */
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace machine {
+
+	/**
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * 									Tracer
+	 * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	 * records timed spans of the engine's work, and writes them out in the Chrome trace event
+	 * format, to be opened in chrome://tracing or https://ui.perfetto.dev
+	 *
+	 * the spans are:
+	 *
+	 * 		forward / forward32 (layer) - a layer's propogation kernel, in training or inference
+	 * 		recompute (network) - rerunning the layers between two checkpoints in the backward pass
+	 * 		backward (layer) - a layer's delta, gradient and propogated error
+	 * 		update (layer) - the optimizer step of a layer
+	 * 		task (pool) - a chunk of a parallel loop, on whichever thread ran it
+	 *
+	 * every thread appends to a buffer of its own, so recording a span doesn't contend with other
+	 * threads. Tracing is off until 'start' is called; while it's off a span costs one relaxed
+	 * atomic load.
+	 *
+	 */
+	class Tracer
+	{
+	public:
+
+		// the process-wide tracer the engine records to
+		static Tracer& global ();
+
+		// drop anything recorded so far, and start recording
+		void start ();
+		void stop ();
+
+		bool enabled () const
+		{
+			return this->on.load( std::memory_order_relaxed );
+		}
+
+		// stop recording, and write every span recorded since 'start' as a JSON trace
+		void write ( std::string );
+		void write ( std::ostream& );
+
+		// number of spans recorded since 'start'
+		size_t events () const;
+
+		// the name the calling thread is shown under
+		void nameThread ( std::string );
+
+		// add a finished span to the calling thread's buffer; times from 'now'
+		void record ( const char*, const char*, int64_t, int64_t, int );
+
+		// nanoseconds on the steady clock
+		static int64_t now ();
+
+	private:
+
+		Tracer ();
+
+		struct Event
+		{
+			const char* name;
+			const char* category;
+			int64_t begin;
+			int64_t end;
+			int layer;
+		};
+
+		// the lock is only ever contended by 'start' and 'write'
+		struct Buffer
+		{
+			int tid;
+			std::string name;
+			std::vector<Event> events;
+			std::mutex mutex;
+		};
+
+		Buffer& local ();
+
+		std::atomic<bool> on;
+		std::atomic<int64_t> epoch;
+
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<Buffer> > buffers;
+
+	}; // end class Tracer
+
+	/**
+	 * a span from construction to destruction, recorded to the global tracer if it was enabled when the span began
+	 *
+	 * :param name - what's being done; must outlive the trace (a string literal)
+	 * :param category - the kind of work (eg. "layer", "pool")
+	 * :param layer - index of the layer, or -1
+	 */
+	class TraceSpan
+	{
+	public:
+
+		TraceSpan ( const char* name, const char* category, int layer = -1 )
+			: name(name), category(category), layer(layer), begin( Tracer::global().enabled() ? Tracer::now() : -1 ) {}
+
+		~TraceSpan()
+		{
+			this->end();
+		}
+
+		// end the span before it goes out of scope
+		void end ()
+		{
+			if ( this->begin >= 0 )
+				Tracer::global().record( this->name, this->category, this->begin, Tracer::now(), this->layer );
+
+			this->begin = -1;
+		}
+
+	private:
+
+		TraceSpan ( const TraceSpan& );
+		TraceSpan& operator= ( const TraceSpan& );
+
+		const char* name;
+		const char* category;
+		int layer;
+		int64_t begin;
+
+	}; // end class TraceSpan
+}
+
+#endif